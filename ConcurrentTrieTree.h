@@ -0,0 +1,280 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "EpochReclaimer.h"
+#include "TrieTree.h"
+
+/*
+ * 读多写少的并发 Trie 树
+ * 读操作(search/count/has_prefix/prefixWords)不加锁, 写操作(insert/erase/
+ * clear)由一个互斥锁串行化.
+ * 每个节点的孩子保存在一个按字符有序的只读块中, 写线程修改孩子时复制出新的
+ * 块, 以 release 语义替换指针(copy-on-write), 读线程总是看到某个完整的块.
+ * 被替换的块和被删除的节点通过 epoch_reclaimer 延迟释放, 读线程进入
+ * epoch 临界区(pin)时不会等待, 活跃的读线程数没有上限.
+ * 每次修改孩子都会复制整个块, 适用于更新较少的词典
+ * */
+template <class T = char, T endMark = '\0'>
+class ConcurrentTrieTree {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "ConcurrentTrieTree labels must be trivially copyable");
+
+   public:
+    using sequence_type =
+        typename std::conditional<isChar<T>::value, std::basic_string<T>,
+                                  std::vector<T>>::type;
+    using const_reference_list_type = const sequence_type &;
+    using ct_iterator = typename sequence_type::const_iterator;
+
+    // 累计的 retire 个数达到该值时回收一次
+    static constexpr size_t RECLAIM_THRESHOLD = 64;
+
+    ConcurrentTrieTree() { root = new node_t(); }
+    ConcurrentTrieTree(const ConcurrentTrieTree &) = delete;
+    ConcurrentTrieTree &operator=(const ConcurrentTrieTree &) = delete;
+    // 析构时不能再有其他线程访问
+    ~ConcurrentTrieTree() {
+        __destroy(root);
+        root = nullptr;
+    }
+
+    // 将一个序列/单词插入到trie中
+    void insert(ct_iterator first, ct_iterator last) {
+        std::lock_guard<std::mutex> lock(write_mutex);
+        node_t *x = root;
+        for (; first != last; first++) {
+            if (*first == endMark) continue;
+            node_t *y = __child(x, *first);
+            if (!y) {
+                y = new node_t();
+                __add_child(x, *first, y);
+            }
+            x = y;
+        }
+        x->count.fetch_add(1, std::memory_order_release);
+        __maybe_reclaim();
+    }
+    void insert(const_reference_list_type s) { insert(s.begin(), s.end()); }
+
+    /**
+     * @brief 删除一次出现, 次数减为 0 且没有孩子的节点被摘除并延迟释放
+     * @retval 序列/单词存在时返回 true
+     */
+    bool erase(ct_iterator first, ct_iterator last) {
+        std::lock_guard<std::mutex> lock(write_mutex);
+        std::vector<std::pair<node_t *, T>> path;
+        node_t *x = root;
+        for (; first != last; first++) {
+            if (*first == endMark) continue;
+            node_t *y = __child(x, *first);
+            if (!y) return false;
+            path.emplace_back(x, *first);
+            x = y;
+        }
+        if (x->count.load(std::memory_order_relaxed) == 0) return false;
+        x->count.fetch_sub(1, std::memory_order_release);
+        // 自底向上摘除不再需要的节点
+        while (!path.empty() &&
+               x->count.load(std::memory_order_relaxed) == 0 &&
+               !x->children.load(std::memory_order_relaxed)) {
+            auto [parent, c] = path.back();
+            path.pop_back();
+            __remove_child(parent, c);
+            reclaimer.retire(x);
+            x = parent;
+        }
+        __maybe_reclaim();
+        return true;
+    }
+    bool erase(const_reference_list_type s) {
+        return erase(s.begin(), s.end());
+    }
+
+    // 清空, 旧的节点在读线程离开后释放
+    void clear() {
+        std::lock_guard<std::mutex> lock(write_mutex);
+        block_t *b =
+            root->children.exchange(nullptr, std::memory_order_acq_rel);
+        root->count.store(0, std::memory_order_release);
+        if (b) {
+            for (uint32_t i = 0; i < b->size; i++)
+                __retire_tree(b->items()[i].node);
+            reclaimer.retire(b, &block_t::destroy);
+        }
+        __maybe_reclaim();
+    }
+
+    // 统计某个序列/单词重复出现的次数
+    int count(ct_iterator first, ct_iterator last) {
+        auto guard = reclaimer.pin();
+        const node_t *x = __find(first, last);
+        return x ? x->count.load(std::memory_order_acquire) : 0;
+    }
+    int count(const_reference_list_type s) { return count(s.begin(), s.end()); }
+
+    // 查找一个序列/单词是否存在
+    bool search(ct_iterator first, ct_iterator last) {
+        return count(first, last) > 0;
+    }
+    bool search(const_reference_list_type s) {
+        return search(s.begin(), s.end());
+    }
+
+    // 是否存在以 s 为前缀的单词/序列
+    bool has_prefix(const_reference_list_type s) {
+        auto guard = reclaimer.pin();
+        const node_t *x = __find(s.begin(), s.end());
+        return x && (x->count.load(std::memory_order_acquire) > 0 ||
+                     x->children.load(std::memory_order_acquire));
+    }
+
+    // 获取所有的前缀单词, 结果按字典序, 重复的单词出现 count 次
+    auto prefixWords(const_reference_list_type prefix_str) {
+        std::vector<sequence_type> words;
+        auto guard = reclaimer.pin();
+        const node_t *x = __find(prefix_str.begin(), prefix_str.end());
+        if (!x) return words;
+        sequence_type s = prefix_str;
+        __prefix(x, s, words);
+        return words;
+    }
+
+    // 立即尝试回收, 返回释放的对象个数
+    size_t reclaim() {
+        std::lock_guard<std::mutex> lock(write_mutex);
+        return reclaimer.reclaim();
+    }
+    // 等待回收的对象个数
+    size_t pending() {
+        std::lock_guard<std::mutex> lock(write_mutex);
+        return reclaimer.pending();
+    }
+
+   private:
+    struct node_t;
+    struct entry_t {
+        T label;
+        node_t *node;
+    };
+    // 只读的孩子块: size 个按字符有序的 entry_t 紧跟在块头之后
+    struct alignas(entry_t) block_t {
+        uint32_t size;
+
+        entry_t *items() { return reinterpret_cast<entry_t *>(this + 1); }
+        const entry_t *items() const {
+            return reinterpret_cast<const entry_t *>(this + 1);
+        }
+        static block_t *make(uint32_t n) {
+            void *p = ::operator new(sizeof(block_t) + n * sizeof(entry_t));
+            block_t *b = new (p) block_t;
+            b->size = n;
+            return b;
+        }
+        static void destroy(void *p) { ::operator delete(p); }
+    };
+    struct node_t {
+        std::atomic<int> count{0};
+        // 没有孩子时为 nullptr
+        std::atomic<block_t *> children{nullptr};
+    };
+
+    static const node_t *__child(const node_t *x, T c) {
+        const block_t *b = x->children.load(std::memory_order_acquire);
+        if (!b) return nullptr;
+        const entry_t *first = b->items(), *last = first + b->size;
+        auto it = std::lower_bound(
+            first, last, c, [](const entry_t &e, T c) { return e.label < c; });
+        return it != last && it->label == c ? it->node : nullptr;
+    }
+    static node_t *__child(node_t *x, T c) {
+        return const_cast<node_t *>(__child((const node_t *)x, c));
+    }
+
+    const node_t *__find(ct_iterator first, ct_iterator last) const {
+        const node_t *x = root;
+        for (; x && first != last; first++)
+            if (*first != endMark) x = __child(x, *first);
+        return x;
+    }
+
+    // 复制出插入了 (c, y) 的新块并发布
+    void __add_child(node_t *x, T c, node_t *y) {
+        block_t *old = x->children.load(std::memory_order_relaxed);
+        uint32_t n = old ? old->size : 0;
+        block_t *b = block_t::make(n + 1);
+        uint32_t j = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            if (j == i && c < old->items()[i].label)
+                new (&b->items()[j++]) entry_t{c, y};
+            new (&b->items()[j++]) entry_t(old->items()[i]);
+        }
+        if (j == n) new (&b->items()[j]) entry_t{c, y};
+        x->children.store(b, std::memory_order_release);
+        if (old) reclaimer.retire(old, &block_t::destroy);
+    }
+
+    // 复制出删除了 c 的新块并发布, 块为空时置为 nullptr
+    void __remove_child(node_t *x, T c) {
+        block_t *old = x->children.load(std::memory_order_relaxed);
+        block_t *b = nullptr;
+        if (old->size > 1) {
+            b = block_t::make(old->size - 1);
+            uint32_t j = 0;
+            for (uint32_t i = 0; i < old->size; i++)
+                if (old->items()[i].label != c)
+                    new (&b->items()[j++]) entry_t(old->items()[i]);
+        }
+        x->children.store(b, std::memory_order_release);
+        reclaimer.retire(old, &block_t::destroy);
+    }
+
+    void __retire_tree(node_t *x) {
+        block_t *b = x->children.load(std::memory_order_relaxed);
+        if (b) {
+            for (uint32_t i = 0; i < b->size; i++)
+                __retire_tree(b->items()[i].node);
+            reclaimer.retire(b, &block_t::destroy);
+        }
+        reclaimer.retire(x);
+    }
+
+    void __destroy(node_t *x) {
+        block_t *b = x->children.load(std::memory_order_relaxed);
+        if (b) {
+            for (uint32_t i = 0; i < b->size; i++)
+                __destroy(b->items()[i].node);
+            block_t::destroy(b);
+        }
+        delete x;
+    }
+
+    void __maybe_reclaim() {
+        if (reclaimer.pending() >= RECLAIM_THRESHOLD) reclaimer.reclaim();
+    }
+
+    void __prefix(const node_t *x, sequence_type &s,
+                  std::vector<sequence_type> &words) const {
+        int count = x->count.load(std::memory_order_acquire);
+        for (int i = 0; i < count; i++) words.push_back(s);
+        const block_t *b = x->children.load(std::memory_order_acquire);
+        if (!b) return;
+        for (uint32_t i = 0; i < b->size; i++) {
+            s.push_back(b->items()[i].label);
+            __prefix(b->items()[i].node, s, words);
+            s.pop_back();
+        }
+    }
+
+   private:
+    node_t *root;
+    std::mutex write_mutex;
+    epoch_reclaimer reclaimer;
+};
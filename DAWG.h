@@ -0,0 +1,343 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "TrieTree.h"
+
+/*
+ * 最小化的有向无环单词图 (DAWG / 最小确定性无环自动机)
+ * 用于只读的词典: 共享前缀的同时也共享后缀("-ing", "-tion"...), 由有序输入
+ * 增量最小化构建(Daciuk 算法), 也可以由一棵 TrieTree 构建.
+ * 由于多个单词共享同一个终止状态, 出现次数不能保存在节点上: 每个状态记录
+ * 其右语言中的单词数, 每条边记录跳过的单词数, 沿路径累加得到单词在词典中
+ * 的序号(完美哈希), 次数保存在以序号为下标的 counts 数组中
+ * */
+template <class T = char, T endMark = '\0'>
+class DAWG {
+   public:
+    using sequence_type =
+        typename std::conditional<isChar<T>::value, std::basic_string<T>,
+                                  std::vector<T>>::type;
+    using const_reference_list_type = const sequence_type &;
+    using ct_iterator = typename sequence_type::const_iterator;
+
+    DAWG() { clear(); }
+
+    template <int Type, template <class> class Alloc>
+    explicit DAWG(TrieTree<T, Type, endMark, Alloc> &trie) {
+        build(trie);
+    }
+
+    /**
+     * @brief 由有序的序列/单词构建, 重复的单词累加出现次数
+     * @retval 输入无序时返回 false, 此时 DAWG 为空
+     */
+    template <class It>
+    bool build_sorted(It first, It last) {
+        clear();
+        __begin();
+        sequence_type word;
+        for (; first != last; ++first) {
+            word.clear();
+            for (auto c : *first)
+                if (c != endMark) word.push_back(c);
+            if (!__add(word, 1)) {
+                clear();
+                return false;
+            }
+        }
+        __finish();
+        return true;
+    }
+
+    /**
+     * @brief 由一棵 TrieTree 按字典序枚举所有单词构建
+     * @retval 枚举的顺序与 __less 不一致时返回 false, 此时 DAWG 为空
+     */
+    template <int Type, template <class> class Alloc>
+    bool build(TrieTree<T, Type, endMark, Alloc> &trie) {
+        clear();
+        __begin();
+        sequence_type word;
+        if (!__walk(trie.get_root(), word)) {
+            clear();
+            return false;
+        }
+        __finish();
+        return true;
+    }
+
+    void clear() {
+        nodes.clear();
+        labels.clear();
+        targets.clear();
+        offsets.clear();
+        counts.clear();
+        source_nodes = 0;
+    }
+
+    // 查找一个序列/单词是否存在
+    bool search(ct_iterator first, ct_iterator last) const {
+        return count(first, last) > 0;
+    }
+    bool search(const_reference_list_type s) const {
+        return search(s.begin(), s.end());
+    }
+
+    // 统计某个序列/单词重复出现的次数
+    int count(ct_iterator first, ct_iterator last) const {
+        if (nodes.empty()) return 0;
+        uint32_t s = 0, index = 0;
+        for (; first != last; first++) {
+            if (*first == endMark) continue;
+            int e = __find_edge(s, *first);
+            if (e < 0) return 0;
+            index += offsets[e];
+            s = targets[e];
+        }
+        return nodes[s].final ? counts[index] : 0;
+    }
+    int count(const_reference_list_type s) const {
+        return count(s.begin(), s.end());
+    }
+
+    // 获取所有的前缀单词, 与 TrieTree::prefixWords 的结果一致
+    auto prefixWords(const_reference_list_type prefix_str) const {
+        std::vector<sequence_type> words;
+        if (nodes.empty()) return words;
+        uint32_t s = 0, index = 0;
+        for (auto c : prefix_str) {
+            if (c == endMark) continue;
+            int e = __find_edge(s, c);
+            if (e < 0) return words;
+            index += offsets[e];
+            s = targets[e];
+        }
+        sequence_type v = prefix_str;
+        __prefix(s, index, v, words);
+        return words;
+    }
+
+    // 状态数和边数
+    size_t node_count() const { return nodes.size(); }
+    size_t edge_count() const { return labels.size(); }
+    // 对应的 trie 的节点数(包括根节点), 用于比较最小化的效果
+    size_t source_node_count() const { return source_nodes; }
+    // 不同单词的个数
+    size_t size() const { return counts.size(); }
+
+    size_t size_in_bytes() const {
+        return sizeof(*this) + nodes.capacity() * sizeof(node_t) +
+               labels.capacity() * sizeof(T) +
+               targets.capacity() * sizeof(uint32_t) +
+               offsets.capacity() * sizeof(uint32_t) +
+               counts.capacity() * sizeof(int);
+    }
+
+   private:
+    // 压缩后的状态: 出边为 [first_edge, first_edge + edge_count)
+    struct node_t {
+        uint32_t first_edge;
+        uint32_t edge_count;
+        // 右语言中的单词数
+        uint32_t words;
+        bool final;
+    };
+
+    // 构建过程中的状态
+    struct build_node_t {
+        bool final = false;
+        std::vector<std::pair<T, uint32_t>> edges;
+    };
+
+    // 字符的顺序, 与 sequence_type 的比较一致: 字符类型按 char_traits
+    // 比较(char 按无符号字节, 与 std::string 和 std::sort 的顺序相同)
+    static bool __less(T a, T b) {
+        if constexpr (isChar<T>::value)
+            return std::char_traits<T>::lt(a, b);
+        else
+            return a < b;
+    }
+
+    // 状态的签名: 是否终止以及所有出边, 签名相同的状态等价
+    struct signature_hash {
+        size_t operator()(const std::vector<uint64_t> &v) const {
+            uint64_t h = 1469598103934665603ull;
+            for (auto x : v) h = (h ^ x) * 1099511628211ull;
+            return (size_t)h;
+        }
+    };
+
+    void __begin() {
+        building.assign(1, build_node_t{});
+        reg.clear();
+        prev.clear();
+        source_nodes = 1;
+    }
+
+    // 按字典序添加一个单词, 与前一个单词相同时只累加次数
+    bool __add(const sequence_type &word, int count) {
+        if (!counts.empty()) {
+            if (word < prev) return false;
+            if (word == prev) {
+                counts.back() += count;
+                return true;
+            }
+        }
+        // 与前一个单词的公共前缀一定沿着每个状态的最后一条边
+        size_t lcp = 0;
+        uint32_t s = 0;
+        while (lcp < word.size() && !building[s].edges.empty() &&
+               building[s].edges.back().first == word[lcp]) {
+            s = building[s].edges.back().second;
+            lcp++;
+        }
+        if (!building[s].edges.empty()) __replace_or_register(s);
+        for (size_t i = lcp; i < word.size(); i++) {
+            building.push_back(build_node_t{});
+            uint32_t t = (uint32_t)building.size() - 1;
+            building[s].edges.emplace_back(word[i], t);
+            s = t;
+        }
+        building[s].final = true;
+        counts.push_back(count);
+        source_nodes += word.size() - lcp;
+        prev = word;
+        return true;
+    }
+
+    // 最后一个孩子的子树已经不会再改变, 将其替换为等价的已注册状态
+    void __replace_or_register(uint32_t s) {
+        uint32_t child = building[s].edges.back().second;
+        if (!building[child].edges.empty()) __replace_or_register(child);
+        auto sig = __signature(child);
+        auto it = reg.find(sig);
+        if (it != reg.end()) {
+            building[s].edges.back().second = it->second;
+            // 被替换的状态不再使用
+            building[child].edges.clear();
+            building[child].edges.shrink_to_fit();
+        } else {
+            reg.emplace(std::move(sig), child);
+        }
+    }
+
+    std::vector<uint64_t> __signature(uint32_t s) const {
+        std::vector<uint64_t> sig{building[s].final ? 1u : 0u};
+        for (auto &e : building[s].edges) {
+            sig.push_back((uint64_t)e.first);
+            sig.push_back(e.second);
+        }
+        return sig;
+    }
+
+    template <class node_pointer>
+    bool __walk(node_pointer x, sequence_type &word) {
+        if (x->isLeaf && x->count > 0 && !__add(word, x->count)) return false;
+        // 无序trie的孩子需要先排序
+        std::vector<std::pair<T, node_pointer>> kids;
+        for (auto it = x->children.begin(); it != x->children.end(); ++it)
+            if (it->second) kids.emplace_back(it->first, it->second);
+        std::sort(kids.begin(), kids.end(),
+                  [](auto &a, auto &b) { return __less(a.first, b.first); });
+        for (auto &k : kids) {
+            word.push_back(k.first);
+            if (!__walk(k.second, word)) return false;
+            word.pop_back();
+        }
+        return true;
+    }
+
+    // 压缩为连续的数组, 并计算每个状态的右语言大小和每条边的序号偏移
+    void __finish() {
+        if (!building[0].edges.empty()) __replace_or_register(0);
+
+        std::vector<uint32_t> id(building.size(), UINT32_MAX);
+        std::vector<uint32_t> order{0};
+        id[0] = 0;
+        for (size_t i = 0; i < order.size(); i++)
+            for (auto &e : building[order[i]].edges)
+                if (id[e.second] == UINT32_MAX) {
+                    id[e.second] = (uint32_t)order.size();
+                    order.push_back(e.second);
+                }
+
+        nodes.assign(order.size(), node_t{});
+        for (size_t i = 0; i < order.size(); i++) {
+            auto &b = building[order[i]];
+            nodes[i].first_edge = (uint32_t)labels.size();
+            nodes[i].edge_count = (uint32_t)b.edges.size();
+            nodes[i].final = b.final;
+            for (auto &e : b.edges) {
+                labels.push_back(e.first);
+                targets.push_back(id[e.second]);
+            }
+        }
+        offsets.assign(labels.size(), 0);
+        std::vector<bool> done(nodes.size(), false);
+        __count_words(0, done);
+
+        building.clear();
+        building.shrink_to_fit();
+        reg.clear();
+        prev.clear();
+        labels.shrink_to_fit();
+        targets.shrink_to_fit();
+        counts.shrink_to_fit();
+    }
+
+    uint32_t __count_words(uint32_t s, std::vector<bool> &done) {
+        node_t &n = nodes[s];
+        if (done[s]) return n.words;
+        uint32_t words = n.final ? 1 : 0;
+        for (uint32_t e = n.first_edge; e < n.first_edge + n.edge_count; e++) {
+            offsets[e] = words;
+            words += __count_words(targets[e], done);
+        }
+        nodes[s].words = words;
+        done[s] = true;
+        return words;
+    }
+
+    // 出边按字符有序, 二分查找
+    int __find_edge(uint32_t s, T c) const {
+        const node_t &n = nodes[s];
+        auto first = labels.begin() + n.first_edge;
+        auto last = first + n.edge_count;
+        auto it = std::lower_bound(first, last, c, __less);
+        if (it == last || *it != c) return -1;
+        return (int)(it - labels.begin());
+    }
+
+    void __prefix(uint32_t s, uint32_t index, sequence_type &v,
+                  std::vector<sequence_type> &words) const {
+        const node_t &n = nodes[s];
+        if (n.final)
+            for (int k = 0; k < counts[index]; k++) words.push_back(v);
+        for (uint32_t e = n.first_edge; e < n.first_edge + n.edge_count; e++) {
+            v.push_back(labels[e]);
+            __prefix(targets[e], index + offsets[e], v, words);
+            v.pop_back();
+        }
+    }
+
+   private:
+    std::vector<node_t> nodes;
+    std::vector<T> labels;
+    std::vector<uint32_t> targets;
+    std::vector<uint32_t> offsets;
+    // 以单词序号为下标的出现次数
+    std::vector<int> counts;
+    size_t source_nodes = 0;
+
+    // 构建过程中使用
+    std::vector<build_node_t> building;
+    std::unordered_map<std::vector<uint64_t>, uint32_t, signature_hash> reg;
+    sequence_type prev;
+};
@@ -0,0 +1,355 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "TrieTree.h"
+
+/*
+ * 双数组Trie (Double-Array Trie)
+ * 由一棵已经构建完成的 TrieTree 编译得到的只读结构, 用 base/check 两个数组
+ * 表示状态转移:
+ *   t = base[s] + code(c), 当 check[t] == s 时表示 s --c--> t
+ * code=0 保留给单词结束标记, 字母表中的字符按顺序编码为 1..K
+ * 只有一个单词经过的后缀不再展开为状态, 而是存放到 tail 数组中(尾部压缩),
+ * 此时 base[s] = -(1 + 记录下标)
+ * */
+template <class T = char, T endMark = '\0'>
+class DoubleArrayTrie {
+   public:
+    using self_type = DoubleArrayTrie<T, endMark>;
+
+    using sequence_type =
+        typename std::conditional<isChar<T>::value, std::basic_string<T>,
+                                  std::vector<T>>::type;
+    using const_reference_list_type = const sequence_type &;
+    using ct_iterator = typename sequence_type::const_iterator;
+
+    DoubleArrayTrie() { __reset(); }
+
+    template <int Type, template <class> class Alloc>
+    explicit DoubleArrayTrie(TrieTree<T, Type, endMark, Alloc> &trie) {
+        build(trie);
+    }
+
+    // 将一棵 TrieTree 编译为双数组
+    template <int Type, template <class> class Alloc>
+    void build(TrieTree<T, Type, endMark, Alloc> &trie) {
+        using node_pointer =
+            typename TrieTree<T, Type, endMark, Alloc>::node_pointer;
+        __reset();
+
+        // 统计每个节点子树中的单词数, 用于判断是否可以进行尾部压缩
+        std::unordered_map<node_pointer, int> leaves;
+        __count_leaves(trie.get_root(), leaves);
+        __build_alphabet(trie.get_root());
+        __build(0, trie.get_root(), leaves);
+
+        // 去掉末尾未使用的空间
+        int used = (int)check.size();
+        while (used > 1 && check[used - 1] < 0) used--;
+        base.resize(used);
+        check.resize(used);
+        base.shrink_to_fit();
+        check.shrink_to_fit();
+        tail.shrink_to_fit();
+        records.shrink_to_fit();
+    }
+
+    // 查找一个序列/单词是否存在
+    bool search(ct_iterator first, ct_iterator last) const {
+        return count(first, last) > 0;
+    }
+    bool search(const_reference_list_type s) const {
+        return search(s.begin(), s.end());
+    }
+
+    // 统计某个序列/单词重复出现的次数
+    int count(ct_iterator first, ct_iterator last) const {
+        int s = 0;
+        for (; first != last; first++) {
+            if (*first == endMark) continue;
+            // 进入尾部压缩区域, 直接与 tail 比较剩余部分
+            if (base[s] < 0) {
+                const record_t &r = records[-base[s] - 1];
+                int i = __tail_match(r, 0, first, last);
+                return i == r.tail_len ? r.count : 0;
+            }
+            int c = code(*first);
+            if (c < 0) return 0;
+            int t = base[s] + c;
+            if (t <= 0 || t >= (int)check.size() || check[t] != s) return 0;
+            s = t;
+        }
+        if (base[s] < 0) {
+            const record_t &r = records[-base[s] - 1];
+            return r.tail_len == 0 ? r.count : 0;
+        }
+        // 单词结束标记 code=0
+        int t = base[s];
+        if (t > 0 && t < (int)check.size() && check[t] == s)
+            return records[-base[t] - 1].count;
+        return 0;
+    }
+    int count(const_reference_list_type s) const {
+        return count(s.begin(), s.end());
+    }
+
+    // 获取所有的前缀单词, 与 TrieTree::prefixWords 的结果一致
+    auto prefixWords(const_reference_list_type prefix_str) const {
+        std::vector<sequence_type> words;
+        sequence_type s = prefix_str;
+        int state = 0;
+        for (auto first = prefix_str.begin(); first != prefix_str.end();
+             first++) {
+            if (*first == endMark) continue;
+            if (base[state] < 0) {
+                // 前缀结束于 tail 内部
+                const record_t &r = records[-base[state] - 1];
+                int i = __tail_match(r, 0, first, prefix_str.end());
+                if (i < 0) return words;
+                for (; i < r.tail_len; i++) s.push_back(tail[r.tail_pos + i]);
+                for (int k = 0; k < r.count; k++) words.push_back(s);
+                return words;
+            }
+            int c = code(*first);
+            if (c < 0) return words;
+            int t = base[state] + c;
+            if (t <= 0 || t >= (int)check.size() || check[t] != state)
+                return words;
+            state = t;
+        }
+        __prefix(state, s, words);
+        return words;
+    }
+
+    // 字母表中的字符编码, 不存在时返回 -1
+    int code(T c) const {
+        if constexpr (sizeof(T) == 1) {
+            return codes[(unsigned char)c];
+        } else {
+            auto it = codes.find(c);
+            return it == codes.end() ? -1 : it->second;
+        }
+    }
+
+    // 双数组占用的内存字节数
+    size_t size_in_bytes() const {
+        size_t bytes = sizeof(self_type);
+        bytes += base.capacity() * sizeof(int32_t);
+        bytes += check.capacity() * sizeof(int32_t);
+        bytes += tail.capacity() * sizeof(T);
+        bytes += records.capacity() * sizeof(record_t);
+        bytes += labels.capacity() * sizeof(T);
+        if constexpr (sizeof(T) != 1)
+            bytes += codes.size() * (sizeof(T) + sizeof(int) + sizeof(void *));
+        return bytes;
+    }
+    // 状态数组的长度
+    size_t size() const { return base.size(); }
+
+   private:
+    // 单词记录: 尾部后缀在 tail 中的位置/长度, 以及单词出现的次数
+    struct record_t {
+        int32_t tail_pos;
+        int32_t tail_len;
+        int32_t count;
+    };
+
+    void __reset() {
+        base.assign(1, 0);
+        check.assign(1, 0);
+        tail.clear();
+        records.clear();
+        labels.assign(1, T());
+        next_check_pos = 1;
+        if constexpr (sizeof(T) == 1)
+            codes.fill(-1);
+        else
+            codes.clear();
+    }
+
+    template <class node_pointer>
+    int __count_leaves(node_pointer x,
+                       std::unordered_map<node_pointer, int> &leaves) {
+        int n = x->isLeaf && x->count > 0 ? 1 : 0;
+        for (auto it = x->children.begin(); it != x->children.end(); ++it)
+            if (it->second) n += __count_leaves(it->second, leaves);
+        leaves[x] = n;
+        return n;
+    }
+
+    // 收集所有出现过的字符并按顺序编码, 保证枚举结果有序
+    template <class node_pointer>
+    void __build_alphabet(node_pointer root) {
+        std::vector<T> alphabet;
+        std::vector<node_pointer> stk{root};
+        while (!stk.empty()) {
+            node_pointer x = stk.back();
+            stk.pop_back();
+            for (auto it = x->children.begin(); it != x->children.end();
+                 ++it) {
+                if (!it->second) continue;
+                alphabet.push_back(it->first);
+                stk.push_back(it->second);
+            }
+        }
+        std::sort(alphabet.begin(), alphabet.end());
+        alphabet.erase(std::unique(alphabet.begin(), alphabet.end()),
+                       alphabet.end());
+        for (size_t i = 0; i < alphabet.size(); i++) {
+            if constexpr (sizeof(T) == 1)
+                codes[(unsigned char)alphabet[i]] = (int)i + 1;
+            else
+                codes[alphabet[i]] = (int)i + 1;
+            labels.push_back(alphabet[i]);
+        }
+    }
+
+    void __resize(int n) {
+        if (n <= (int)check.size()) return;
+        int m = std::max(n, (int)check.size() * 2);
+        base.resize(m, 0);
+        check.resize(m, -1);
+    }
+
+    // 为一组孩子节点寻找可用的 base 值
+    int __find_base(const std::vector<int> &kids) {
+        int pos = std::max(kids.front() + 1, next_check_pos) - 1;
+        int nonzero = 0;
+        bool first = true;
+        int begin = 0;
+        while (true) {
+            pos++;
+            __resize(pos + 1);
+            if (check[pos] >= 0) {
+                nonzero++;
+                continue;
+            } else if (first) {
+                next_check_pos = pos;
+                first = false;
+            }
+            begin = pos - kids.front();
+            __resize(begin + kids.back() + 1);
+            bool ok = true;
+            for (size_t i = 1; i < kids.size() && ok; i++)
+                ok = check[begin + kids[i]] < 0;
+            if (ok) break;
+        }
+        // 已经比较密集的区域, 下一次不再从头扫描
+        if (1.0 * nonzero / (pos - next_check_pos + 1) >= 0.95)
+            next_check_pos = pos;
+        return begin;
+    }
+
+    int __add_record(int tail_pos, int count) {
+        records.push_back(
+            record_t{tail_pos, (int32_t)tail.size() - tail_pos, count});
+        return -(int)records.size();
+    }
+
+    template <class node_pointer>
+    void __build(int s, node_pointer x,
+                 const std::unordered_map<node_pointer, int> &leaves) {
+        std::vector<std::pair<int, node_pointer>> kids;
+        if (x->isLeaf && x->count > 0) kids.emplace_back(0, nullptr);
+        for (auto it = x->children.begin(); it != x->children.end(); ++it) {
+            if (!it->second || leaves.at(it->second) == 0) continue;
+            kids.emplace_back(code(it->first), it->second);
+        }
+        if (kids.empty()) {
+            base[s] = __add_record((int)tail.size(), 0);
+            return;
+        }
+        std::sort(kids.begin(), kids.end(),
+                  [](auto &a, auto &b) { return a.first < b.first; });
+
+        std::vector<int> kcodes;
+        for (auto &k : kids) kcodes.push_back(k.first);
+        int b = __find_base(kcodes);
+        base[s] = b;
+        // 先占用所有孩子的位置, 再递归
+        for (auto &k : kids) check[b + k.first] = s;
+
+        for (auto &k : kids) {
+            int t = b + k.first;
+            if (k.first == 0) {
+                base[t] = __add_record((int)tail.size(), x->count);
+            } else if (leaves.at(k.second) == 1) {
+                // 只剩一个单词经过, 剩余的单链存放到 tail 中
+                int tail_pos = (int)tail.size();
+                node_pointer y = k.second;
+                while (!y->isLeaf || y->count == 0) {
+                    for (auto it = y->children.begin();
+                         it != y->children.end(); ++it) {
+                        if (it->second && leaves.at(it->second) == 1) {
+                            tail.push_back(it->first);
+                            y = it->second;
+                            break;
+                        }
+                    }
+                }
+                base[t] = __add_record(tail_pos, y->count);
+            } else {
+                __build(t, k.second, leaves);
+            }
+        }
+    }
+
+    // 将 [first, last) 与记录 r 的 tail 从 i 开始比较,
+    // 返回匹配到的 tail 位置, 不匹配时返回 -1
+    int __tail_match(const record_t &r, int i, ct_iterator first,
+                     ct_iterator last) const {
+        for (; first != last; first++) {
+            if (*first == endMark) continue;
+            if (i >= r.tail_len || tail[r.tail_pos + i] != *first) return -1;
+            i++;
+        }
+        return i;
+    }
+
+    void __prefix(int s, sequence_type &v,
+                  std::vector<sequence_type> &words) const {
+        if (base[s] < 0) {
+            const record_t &r = records[-base[s] - 1];
+            for (int i = 0; i < r.tail_len; i++)
+                v.push_back(tail[r.tail_pos + i]);
+            for (int k = 0; k < r.count; k++) words.push_back(v);
+            v.resize(v.size() - r.tail_len);
+            return;
+        }
+        int b = base[s];
+        for (int c = 0; c < (int)labels.size(); c++) {
+            int t = b + c;
+            if (t <= 0 || t >= (int)check.size()) continue;
+            if (check[t] != s) continue;
+            if (c == 0) {
+                const record_t &r = records[-base[t] - 1];
+                for (int k = 0; k < r.count; k++) words.push_back(v);
+                continue;
+            }
+            v.push_back(labels[c]);
+            __prefix(t, v, words);
+            v.pop_back();
+        }
+    }
+
+   private:
+    std::vector<int32_t> base;
+    std::vector<int32_t> check;
+    // 尾部压缩的后缀
+    std::vector<T> tail;
+    std::vector<record_t> records;
+    // code -> 字符
+    std::vector<T> labels;
+    // 字符 -> code
+    typename std::conditional<sizeof(T) == 1, std::array<int, 256>,
+                              std::unordered_map<T, int>>::type codes;
+    int next_check_pos;
+};
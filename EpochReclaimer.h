@@ -0,0 +1,138 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * 基于纪元(epoch)的延迟回收
+ * 读线程在访问共享结构前 pin() 一个槽位, 记录当时的全局纪元, 析构 guard 时
+ * 清空槽位. 固定的 MAX_THREADS 个槽位都被占用时, 使用溢出链表中的空闲槽位
+ * 或者用 CAS 加入一个新的槽位, pin() 从不等待其他线程.
+ * 写线程摘除节点后 retire() 节点, 节点被标记为当前纪元.
+ * reclaim() 推进全局纪元, 只释放标记的纪元小于所有活跃读线程纪元的节点,
+ * 这些节点在所有读线程开始之前就已经摘除, 不会再被访问到.
+ * retire()/reclaim() 只能由一个线程(或持有写锁的线程)调用
+ * */
+class epoch_reclaimer {
+   public:
+    // 固定槽位的个数, 同时活跃的读线程更多时使用溢出链表
+    static constexpr size_t MAX_THREADS = 64;
+
+    class guard {
+       public:
+        explicit guard(std::atomic<uint64_t> *epoch) : epoch(epoch) {}
+        guard(const guard &) = delete;
+        guard &operator=(const guard &) = delete;
+        guard(guard &&other) : epoch(other.epoch) { other.epoch = nullptr; }
+        ~guard() {
+            if (epoch) epoch->store(0, std::memory_order_release);
+        }
+
+       private:
+        std::atomic<uint64_t> *epoch;
+    };
+
+    epoch_reclaimer() = default;
+    epoch_reclaimer(const epoch_reclaimer &) = delete;
+    epoch_reclaimer &operator=(const epoch_reclaimer &) = delete;
+    // 析构时不能再有读线程
+    ~epoch_reclaimer() {
+        for (auto &x : retired) x.deleter(x.p);
+        for (slot_t *s = overflow.load(); s;) {
+            slot_t *next = s->next;
+            delete s;
+            s = next;
+        }
+    }
+
+    // 进入读临界区, 返回的 guard 析构时离开. 不会等待其他线程
+    guard pin() {
+        // 每个线程从不同的槽位开始, 通常第一次就能占用成功
+        static std::atomic<size_t> next_hint{0};
+        thread_local size_t hint = next_hint.fetch_add(1);
+        for (size_t k = 0; k < MAX_THREADS; k++) {
+            slot_t &s = slots[(hint + k) % MAX_THREADS];
+            if (__try_acquire(s)) return guard(&s.epoch);
+        }
+        // 固定槽位已满, 占用溢出链表中空闲的槽位
+        for (slot_t *s = overflow.load(std::memory_order_acquire); s;
+             s = s->next)
+            if (__try_acquire(*s)) return guard(&s->epoch);
+        // 没有空闲的槽位, 新的槽位在加入链表前已经记录了纪元
+        slot_t *s = new slot_t;
+        s->epoch.store(global.load());
+        s->next = overflow.load(std::memory_order_relaxed);
+        while (!overflow.compare_exchange_weak(s->next, s)) {
+        }
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return guard(&s->epoch);
+    }
+
+    // 延迟释放一个已经从共享结构中摘除的对象
+    void retire(void *p, void (*deleter)(void *)) {
+        retired.push_back(retired_t{p, deleter, global.load()});
+    }
+    template <class U>
+    void retire(U *p) {
+        retire(p, [](void *q) { delete static_cast<U *>(q); });
+    }
+
+    // 推进纪元并释放可以安全释放的对象, 返回释放的个数
+    size_t reclaim() {
+        uint64_t safe = global.fetch_add(1) + 1;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto oldest = [&](const slot_t &s) {
+            uint64_t e = s.epoch.load();
+            if (e != 0 && e < safe) safe = e;
+        };
+        for (auto &s : slots) oldest(s);
+        for (slot_t *s = overflow.load(); s; s = s->next) oldest(*s);
+        size_t n = 0;
+        for (size_t i = 0; i < retired.size();) {
+            if (retired[i].epoch < safe) {
+                retired[i].deleter(retired[i].p);
+                retired[i] = retired.back();
+                retired.pop_back();
+                n++;
+            } else {
+                i++;
+            }
+        }
+        return n;
+    }
+
+    // 等待释放的对象个数
+    size_t pending() const { return retired.size(); }
+
+   private:
+    struct alignas(64) slot_t {
+        // 0 表示槽位空闲
+        std::atomic<uint64_t> epoch{0};
+        // 溢出链表中的下一个槽位, 加入链表后不再修改
+        slot_t *next = nullptr;
+    };
+    struct retired_t {
+        void *p;
+        void (*deleter)(void *);
+        uint64_t epoch;
+    };
+
+    // 空闲的槽位记录当前纪元
+    bool __try_acquire(slot_t &s) {
+        uint64_t expected = 0;
+        if (!s.epoch.compare_exchange_strong(expected, global.load()))
+            return false;
+        // 与 reclaim() 中的栅栏配对: 要么写线程看到这个槽位,
+        // 要么之后的读操作看到写线程已经完成的摘除
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return true;
+    }
+
+    alignas(64) std::atomic<uint64_t> global{1};
+    slot_t slots[MAX_THREADS];
+    // 溢出的槽位, 只增加不删除, 析构时释放
+    std::atomic<slot_t *> overflow{nullptr};
+    std::vector<retired_t> retired;
+};
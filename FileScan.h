@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+ * 使用ac自动机扫描文件
+ * mmap: 将整个文件映射到内存并设置 MADV_SEQUENTIAL, 零拷贝扫描
+ * read: 使用对齐的大缓冲区循环 read(), 通过流式扫描器处理跨缓冲区的匹配
+ * mmap 失败(例如管道/空文件)时自动退回到 read
+ * */
+enum class scan_io { mmap, read };
+
+// read 方式使用的缓冲区大小和对齐
+constexpr size_t SCAN_BUFFER_SIZE = 1 << 20;
+constexpr size_t SCAN_BUFFER_ALIGN = 4096;
+
+/**
+ * @brief 扫描文件 path, 每个匹配调用一次 visit(const ac_match_t &),
+ * visit 返回 false 时停止
+ * @retval 扫描的字节数(被 visit 提前终止时为最后一个匹配的结束位置),
+ * 文件无法打开, 缓冲区分配失败或读取出错时返回 -1
+ */
+template <class AC, class F>
+int64_t scan_file(AC &ac, const std::string &path, F &&visit,
+                  scan_io io = scan_io::mmap) {
+    auto sc = ac.make_scanner();
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return -1;
+
+    if (io == scan_io::mmap) {
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+            size_t size = (size_t)st.st_size;
+            void *p = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                ::madvise(p, size, MADV_SEQUENTIAL);
+                sc.feed(std::string_view((const char *)p, size), visit);
+                ::munmap(p, size);
+                ::close(fd);
+                return (int64_t)sc.offset();
+            }
+        }
+    }
+
+    char *buf = (char *)std::aligned_alloc(SCAN_BUFFER_ALIGN, SCAN_BUFFER_SIZE);
+    if (!buf) {
+        ::close(fd);
+        return -1;
+    }
+    ssize_t n;
+    for (;;) {
+        n = ::read(fd, buf, SCAN_BUFFER_SIZE);
+        // 被信号中断时重新读取
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        if (!sc.feed(std::string_view(buf, (size_t)n), visit)) break;
+    }
+    std::free(buf);
+    ::close(fd);
+    if (n < 0) return -1;
+#else
+    (void)io;
+    FILE *fp = std::fopen(path.c_str(), "rb");
+    if (!fp) return -1;
+    char *buf = (char *)std::malloc(SCAN_BUFFER_SIZE);
+    if (!buf) {
+        std::fclose(fp);
+        return -1;
+    }
+    size_t n;
+    while ((n = std::fread(buf, 1, SCAN_BUFFER_SIZE, fp)) > 0) {
+        if (!sc.feed(std::string_view(buf, n), visit)) break;
+    }
+    bool failed = std::ferror(fp) != 0;
+    std::free(buf);
+    std::fclose(fp);
+    if (failed) return -1;
+#endif
+    return (int64_t)sc.offset();
+}
+
+/**
+ * @brief 将文件映射到内存后多线程并行扫描, 匹配按偏移顺序回调 visit
+ * @note  无法使用 mmap 时退回到单线程的 scan_file
+ * @retval 与 scan_file 相同: 扫描的字节数, 被 visit 提前终止时为最后一个
+ * 匹配的结束位置, 出错时返回 -1
+ */
+template <class AC, class F>
+int64_t parallel_scan_file(AC &ac, const std::string &path, F &&visit,
+                           unsigned threads = 0) {
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+        size_t size = (size_t)st.st_size;
+        void *p = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            // 每个线程顺序访问自己的分块
+            ::madvise(p, size, MADV_WILLNEED);
+            // 匹配按结束位置的顺序回调, 停止时 end 为最后一个匹配的结束位置
+            size_t end = 0;
+            bool done = ac.parallel_match(
+                std::string_view((const char *)p, size),
+                [&](const ac_match_t &m) {
+                    end = m.start + m.length;
+                    if constexpr (std::is_same_v<
+                                      std::invoke_result_t<F &,
+                                                           const ac_match_t &>,
+                                      bool>) {
+                        return visit(m);
+                    } else {
+                        visit(m);
+                        return true;
+                    }
+                },
+                threads);
+            ::munmap(p, size);
+            ::close(fd);
+            return (int64_t)(done ? size : end);
+        }
+    }
+    ::close(fd);
+#endif
+    (void)threads;
+    return scan_file(ac, path, visit, scan_io::read);
+}
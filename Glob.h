@@ -0,0 +1,211 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/*
+ * 通配符模式(glob): ? 匹配任意一个字符, * 匹配任意长度(包括空)的序列,
+ * [abc] [a-f] 匹配集合中的一个字符, [!a-f] 或 [^a-f] 匹配集合外的一个
+ * 字符, \ 转义下一个字符, 没有闭合的 [ 按普通字符处理.
+ * 模式编译为 NFA: 状态 i 表示已经匹配了前 i 个记号, 状态 n 为接受状态.
+ * 匹配时 NFA 的状态集合按需转换为 DFA 状态并缓存(惰性 DFA), 同一个状态
+ * 集合在同一个字符上的转移只计算一次
+ * */
+template <class T = char>
+class glob_pattern {
+   public:
+    using sequence_type = std::basic_string<T>;
+    using view_type = std::basic_string_view<T>;
+
+    // 死状态, 之后的任何序列都不可能匹配
+    static constexpr int DEAD = -1;
+
+    explicit glob_pattern(view_type pattern) {
+        __parse(pattern);
+        for (auto &t : tokens) {
+            if (t.kind != token_kind::literal) break;
+            prefix.push_back(t.c);
+        }
+        std::vector<uint64_t> bits((tokens.size() + 64) / 64);
+        bits[0] = 1;
+        start_state = __intern(__closure(std::move(bits)));
+    }
+
+    int start() const { return start_state; }
+
+    // 状态 state 读入字符 c 后的状态, 第一次经过时计算并缓存
+    int next(int state, T c) {
+        if (state == DEAD) return DEAD;
+        if constexpr (sizeof(T) == 1) {
+            int &to = states[state].table[(unsigned char)c];
+            if (to != UNKNOWN) return to;
+            int r = __step(state, c);
+            // __step 可能加入新的状态, 重新取引用
+            states[state].table[(unsigned char)c] = r;
+            return r;
+        } else {
+            auto &wide = states[state].wide;
+            if (auto it = wide.find(c); it != wide.end()) return it->second;
+            int r = __step(state, c);
+            states[state].wide.emplace(c, r);
+            return r;
+        }
+    }
+
+    bool accepting(int state) const {
+        return state != DEAD && states[state].accepting;
+    }
+
+    // 第一个通配符之前的字面前缀
+    const sequence_type &literal_prefix() const { return prefix; }
+
+    // 整个序列是否匹配
+    bool match(view_type s) {
+        int state = start_state;
+        for (size_t i = 0; i < s.size() && state != DEAD; i++)
+            state = next(state, s[i]);
+        return accepting(state);
+    }
+
+    // 已经生成的 DFA 状态数
+    size_t dfa_size() const { return states.size(); }
+
+   private:
+    enum class token_kind { literal, any, star, set };
+    struct token_t {
+        token_kind kind = token_kind::literal;
+        T c = T();
+        // 字符集合: 闭区间的列表, negate 时匹配集合外的字符
+        std::vector<std::pair<T, T>> ranges;
+        bool negate = false;
+
+        bool matches(T x) const {
+            switch (kind) {
+                case token_kind::literal: return x == c;
+                case token_kind::set: {
+                    bool in = false;
+                    // 按 char_traits 比较, char 按无符号字节, 与 UTF-8 的顺序一致
+                    using traits = std::char_traits<T>;
+                    for (auto &[lo, hi] : ranges)
+                        if (!traits::lt(x, lo) && !traits::lt(hi, x)) {
+                            in = true;
+                            break;
+                        }
+                    return in != negate;
+                }
+                default: return true;
+            }
+        }
+    };
+    struct dfa_state_t {
+        // NFA 状态集合
+        std::vector<uint64_t> bits;
+        bool accepting = false;
+        // 单字节字符使用 256 项的转移表, 否则使用哈希表
+        std::vector<int> table;
+        std::unordered_map<T, int> wide;
+    };
+    static constexpr int UNKNOWN = -2;
+
+    void __parse(view_type p) {
+        for (size_t i = 0; i < p.size(); i++) {
+            token_t t;
+            t.c = p[i];
+            if (p[i] == T('?')) {
+                t.kind = token_kind::any;
+            } else if (p[i] == T('*')) {
+                // 连续的 * 与一个 * 等价
+                if (!tokens.empty() && tokens.back().kind == token_kind::star)
+                    continue;
+                t.kind = token_kind::star;
+            } else if (p[i] == T('\\') && i + 1 < p.size()) {
+                t.c = p[++i];
+            } else if (p[i] == T('[')) {
+                if (size_t end = __parse_set(p, i + 1, t); end != 0) {
+                    t.kind = token_kind::set;
+                    i = end;
+                }
+            }
+            tokens.push_back(std::move(t));
+        }
+    }
+
+    // 解析 p[i] 开始的字符集合, 返回闭合的 ] 的位置, 没有闭合时返回 0
+    static size_t __parse_set(view_type p, size_t i, token_t &t) {
+        if (i < p.size() && (p[i] == T('!') || p[i] == T('^'))) {
+            t.negate = true;
+            i++;
+        }
+        // 紧跟在 [ 后的 ] 是集合中的字符
+        for (size_t first = i; i < p.size(); i++) {
+            if (p[i] == T(']') && i != first) return i;
+            T lo = p[i];
+            if (lo == T('\\') && i + 1 < p.size()) lo = p[++i];
+            T hi = lo;
+            if (i + 2 < p.size() && p[i + 1] == T('-') && p[i + 2] != T(']')) {
+                hi = p[i + 2];
+                i += 2;
+                if (hi == T('\\') && i + 1 < p.size()) hi = p[++i];
+            }
+            t.ranges.emplace_back(lo, hi);
+        }
+        t.ranges.clear();
+        t.negate = false;
+        return 0;
+    }
+
+    static bool __test(const std::vector<uint64_t> &bits, size_t i) {
+        return bits[i / 64] >> (i % 64) & 1;
+    }
+    static void __set(std::vector<uint64_t> &bits, size_t i) {
+        bits[i / 64] |= uint64_t(1) << (i % 64);
+    }
+
+    // * 可以匹配空序列, 状态 i 的记号为 * 时加入状态 i + 1
+    std::vector<uint64_t> __closure(std::vector<uint64_t> bits) const {
+        for (size_t i = 0; i < tokens.size(); i++)
+            if (__test(bits, i) && tokens[i].kind == token_kind::star)
+                __set(bits, i + 1);
+        return bits;
+    }
+
+    int __step(int state, T c) {
+        std::vector<uint64_t> bits(states[state].bits.size());
+        bool empty = true;
+        for (size_t i = 0; i < tokens.size(); i++) {
+            if (!__test(states[state].bits, i)) continue;
+            if (tokens[i].kind == token_kind::star) {
+                __set(bits, i);
+                empty = false;
+            } else if (tokens[i].matches(c)) {
+                __set(bits, i + 1);
+                empty = false;
+            }
+        }
+        return empty ? DEAD : __intern(__closure(std::move(bits)));
+    }
+
+    int __intern(std::vector<uint64_t> bits) {
+        auto [it, inserted] = ids.try_emplace(bits, (int)states.size());
+        if (inserted) {
+            dfa_state_t s;
+            s.accepting = __test(bits, tokens.size());
+            s.bits = std::move(bits);
+            if constexpr (sizeof(T) == 1) s.table.assign(256, UNKNOWN);
+            states.push_back(std::move(s));
+        }
+        return it->second;
+    }
+
+   private:
+    std::vector<token_t> tokens;
+    sequence_type prefix;
+    std::vector<dfa_state_t> states;
+    std::map<std::vector<uint64_t>, int> ids;
+    int start_state = 0;
+};
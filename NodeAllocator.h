@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <utility>
+
+/*
+ * trie节点的分配策略
+ * heap_node_allocator : 每个节点单独 new/delete
+ * arena_node_allocator: 节点按块(chunk)连续分配, 被删除的节点放入空闲链表
+ *                       复用, release() 一次性释放所有块
+ * 策略需要提供:
+ *   Node *create();           分配并构造一个节点
+ *   void destroy(Node *x);    析构并回收一个节点
+ *   void release();           回收所有节点(仅 bulk_release=true 时使用)
+ *   static constexpr bool bulk_release;
+ * */
+template <class Node>
+struct heap_node_allocator {
+    static constexpr bool bulk_release = false;
+
+    Node *create() { return new Node(); }
+    void destroy(Node *x) { delete x; }
+    void release() {}
+};
+
+template <class Node>
+class arena_node_allocator {
+   public:
+    static constexpr bool bulk_release = true;
+    // 每个块的大小, 块按照该大小对齐, 便于由节点地址找到所在的块
+    static constexpr size_t CHUNK_BYTES = 1 << 16;
+
+    arena_node_allocator() = default;
+    arena_node_allocator(const arena_node_allocator &) = delete;
+    arena_node_allocator &operator=(const arena_node_allocator &) = delete;
+    ~arena_node_allocator() { release(); }
+
+    Node *create() {
+        slot_t *s;
+        if (freelist) {
+            s = freelist;
+            freelist = freelist->next;
+        } else {
+            if (!chunks || chunks->used == SLOTS) __grow();
+            s = &chunks->slots[chunks->used++];
+        }
+        Node *x = new (s->storage) Node();
+        __set_live(s, true);
+        return x;
+    }
+
+    void destroy(Node *x) {
+        x->~Node();
+        slot_t *s = reinterpret_cast<slot_t *>(x);
+        __set_live(s, false);
+        s->next = freelist;
+        freelist = s;
+    }
+
+    // 按块顺序析构所有存活的节点, 然后释放所有块
+    void release() {
+        while (chunks) {
+            chunk_t *c = chunks;
+            chunks = c->next;
+            for (size_t i = 0; i < c->used; i++)
+                if (c->live[i / 64] >> (i % 64) & 1)
+                    reinterpret_cast<Node *>(c->slots[i].storage)->~Node();
+            std::free(c);
+        }
+        freelist = nullptr;
+        nchunks = 0;
+    }
+
+    // 已分配的块数
+    size_t chunk_count() const { return nchunks; }
+
+   private:
+    union slot_t {
+        slot_t *next;
+        alignas(Node) unsigned char storage[sizeof(Node)];
+    };
+    static constexpr size_t SLOTS =
+        (CHUNK_BYTES - 64) * 8 / (8 * sizeof(slot_t) + 1) - 1;
+    static_assert(SLOTS > 0, "node is too large for arena_node_allocator");
+
+    struct chunk_t {
+        chunk_t *next;
+        size_t used;
+        // 每个槽位是否存放着存活的节点
+        uint64_t live[(SLOTS + 63) / 64];
+        slot_t slots[SLOTS];
+    };
+    static_assert(sizeof(chunk_t) <= CHUNK_BYTES, "chunk header too large");
+
+    void __grow() {
+        void *p = std::aligned_alloc(CHUNK_BYTES, CHUNK_BYTES);
+        if (!p) throw std::bad_alloc();
+        chunk_t *c = static_cast<chunk_t *>(p);
+        c->next = chunks;
+        c->used = 0;
+        for (auto &w : c->live) w = 0;
+        chunks = c;
+        nchunks++;
+    }
+
+    static void __set_live(slot_t *s, bool live) {
+        chunk_t *c = reinterpret_cast<chunk_t *>(
+            reinterpret_cast<uintptr_t>(s) & ~(uintptr_t)(CHUNK_BYTES - 1));
+        size_t i = (size_t)(s - c->slots);
+        if (live)
+            c->live[i / 64] |= (uint64_t)1 << (i % 64);
+        else
+            c->live[i / 64] &= ~((uint64_t)1 << (i % 64));
+    }
+
+    chunk_t *chunks = nullptr;
+    slot_t *freelist = nullptr;
+    size_t nchunks = 0;
+};
@@ -0,0 +1,250 @@
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "TrieTree.h"
+
+/*
+ * 路径压缩的 Trie 树(radix tree / Patricia tree)
+ * 只有一个孩子的连续节点合并为一条边, 边上的字符串保存在节点中(短的字符串
+ * 由 std::basic_string 的短字符串优化保存在节点内部). 查找时整段比较边上的
+ * 字符串(字符类型使用 char_traits::compare, 即 memcmp), 而不是逐个字符地
+ * 访问节点. 插入时在分叉处拆分边, 删除后重新合并只剩一个孩子的节点.
+ * 孩子按边的首字符有序保存在数组中
+ * */
+template <class T = char, T endMark = '\0'>
+class RadixTree {
+   public:
+    using sequence_type =
+        typename std::conditional<isChar<T>::value, std::basic_string<T>,
+                                  std::vector<T>>::type;
+    using const_reference_list_type = const sequence_type &;
+    using ct_iterator = typename sequence_type::const_iterator;
+
+    RadixTree() { root = new node_t(); }
+    RadixTree(const RadixTree &) = delete;
+    RadixTree &operator=(const RadixTree &) = delete;
+    ~RadixTree() {
+        __destroy(root);
+        root = nullptr;
+    }
+
+    // 将一个序列/单词插入到树中
+    void insert(const_reference_list_type s) {
+        const sequence_type &key = __strip(s);
+        node_t *x = root;
+        size_t pos = 0;
+        while (pos < key.size()) {
+            auto it = __child(x, key[pos]);
+            if (it == x->children.end() || it->first != key[pos]) {
+                // 剩余部分作为一条新的边
+                node_t *y = new node_t();
+                y->label.assign(key.begin() + pos, key.end());
+                y->count = 1;
+                x->children.insert(it, {key[pos], y});
+                nodes++;
+                words++;
+                return;
+            }
+            node_t *y = it->second;
+            size_t l = __common_prefix(y->label, key, pos);
+            if (l < y->label.size()) {
+                // 在分叉处拆分边: x -> mid -> y
+                node_t *mid = new node_t();
+                mid->label.assign(y->label.begin(), y->label.begin() + l);
+                y->label.erase(y->label.begin(), y->label.begin() + l);
+                mid->children.push_back({y->label[0], y});
+                it->second = mid;
+                nodes++;
+                y = mid;
+            }
+            x = y;
+            pos += l;
+        }
+        if (x->count++ == 0) words++;
+    }
+
+    // 统计某个序列/单词重复出现的次数
+    int count(const_reference_list_type s) const {
+        const node_t *x = __find(__strip(s));
+        return x ? x->count : 0;
+    }
+    // 查找一个序列/单词是否存在
+    bool search(const_reference_list_type s) const { return count(s) > 0; }
+
+    /**
+     * @brief 删除一次出现, 次数减为 0 时删除节点并合并只剩一个孩子的节点
+     * @retval 序列/单词存在时返回 true
+     */
+    bool erase(const_reference_list_type s) {
+        const sequence_type &key = __strip(s);
+        // path[i] 为第 i 个节点的父节点
+        std::vector<node_t *> path;
+        node_t *x = root;
+        size_t pos = 0;
+        while (pos < key.size()) {
+            auto it = __child(x, key[pos]);
+            if (it == x->children.end() || it->first != key[pos]) return false;
+            node_t *y = it->second;
+            if (__common_prefix(y->label, key, pos) != y->label.size())
+                return false;
+            path.push_back(x);
+            x = y;
+            pos += y->label.size();
+        }
+        if (x->count == 0) return false;
+        if (--x->count > 0) return true;
+        words--;
+        if (x == root) return true;
+
+        node_t *parent = path.back();
+        if (x->children.empty()) {
+            // 删除叶子, 父节点可能只剩一个孩子
+            parent->children.erase(__child(parent, x->label[0]));
+            delete x;
+            nodes--;
+            if (parent != root && parent->count == 0 &&
+                parent->children.size() == 1)
+                __merge(parent);
+        } else if (x->children.size() == 1) {
+            __merge(x);
+        }
+        return true;
+    }
+
+    // 获取所有的前缀单词, 结果按字典序, 重复的单词出现 count 次
+    auto prefixWords(const_reference_list_type prefix_str) const {
+        std::vector<sequence_type> words;
+        const sequence_type &key = __strip(prefix_str);
+        const node_t *x = root;
+        sequence_type s;
+        size_t pos = 0;
+        while (pos < key.size()) {
+            auto it = __child(x, key[pos]);
+            if (it == x->children.end() || it->first != key[pos]) return words;
+            const node_t *y = it->second;
+            size_t l = __common_prefix(y->label, key, pos);
+            // 前缀在边的中间结束时, 这条边下的所有单词都匹配
+            if (l < y->label.size() && pos + l < key.size()) return words;
+            s.insert(s.end(), y->label.begin(), y->label.end());
+            x = y;
+            pos += l;
+        }
+        __prefix(x, s, words);
+        return words;
+    }
+
+    void clear() {
+        __destroy(root);
+        root = new node_t();
+        nodes = 0;
+        words = 0;
+    }
+
+    // 不同单词的个数
+    size_t size() const { return words; }
+    // 节点数(不包括根节点)
+    size_t node_count() const { return nodes; }
+
+   private:
+    struct node_t {
+        // 从父节点到该节点的边上的字符串, 根节点为空
+        sequence_type label;
+        int count = 0;
+        // (边的首字符, 孩子), 按首字符有序
+        std::vector<std::pair<T, node_t *>> children;
+    };
+    using child_iterator =
+        typename std::vector<std::pair<T, node_t *>>::iterator;
+    using const_child_iterator =
+        typename std::vector<std::pair<T, node_t *>>::const_iterator;
+
+    // 首字符不小于 c 的第一个孩子
+    static child_iterator __child(node_t *x, T c) {
+        return std::lower_bound(
+            x->children.begin(), x->children.end(), c,
+            [](const std::pair<T, node_t *> &e, T c) { return e.first < c; });
+    }
+    static const_child_iterator __child(const node_t *x, T c) {
+        return std::lower_bound(
+            x->children.begin(), x->children.end(), c,
+            [](const std::pair<T, node_t *> &e, T c) { return e.first < c; });
+    }
+
+    // label 与 key[pos:] 的最长公共前缀
+    static size_t __common_prefix(const sequence_type &label,
+                                  const sequence_type &key, size_t pos) {
+        size_t n = std::min(label.size(), key.size() - pos);
+        if constexpr (isChar<T>::value) {
+            // 整段相同时一次 memcmp 即可
+            if (std::char_traits<T>::compare(label.data(), key.data() + pos,
+                                             n) == 0)
+                return n;
+        }
+        size_t i = 0;
+        while (i < n && label[i] == key[pos + i]) i++;
+        return i;
+    }
+
+    // 去掉 endMark, 没有 endMark 时不复制
+    static const sequence_type &__strip(const sequence_type &s) {
+        if (std::find(s.begin(), s.end(), endMark) == s.end()) return s;
+        thread_local sequence_type stripped;
+        stripped.clear();
+        for (auto c : s)
+            if (c != endMark) stripped.push_back(c);
+        return stripped;
+    }
+
+    const node_t *__find(const sequence_type &key) const {
+        const node_t *x = root;
+        size_t pos = 0;
+        while (pos < key.size()) {
+            auto it = __child(x, key[pos]);
+            if (it == x->children.end() || it->first != key[pos])
+                return nullptr;
+            const node_t *y = it->second;
+            if (y->label.size() > key.size() - pos ||
+                __common_prefix(y->label, key, pos) != y->label.size())
+                return nullptr;
+            x = y;
+            pos += y->label.size();
+        }
+        return x;
+    }
+
+    // x 不是单词且只有一个孩子, 与孩子合并为一条边
+    void __merge(node_t *x) {
+        node_t *y = x->children[0].second;
+        x->label.insert(x->label.end(), y->label.begin(), y->label.end());
+        x->count = y->count;
+        x->children = std::move(y->children);
+        delete y;
+        nodes--;
+    }
+
+    void __prefix(const node_t *x, sequence_type &s,
+                  std::vector<sequence_type> &words) const {
+        for (int i = 0; i < x->count; i++) words.push_back(s);
+        for (auto &e : x->children) {
+            size_t n = s.size();
+            s.insert(s.end(), e.second->label.begin(), e.second->label.end());
+            __prefix(e.second, s, words);
+            s.resize(n);
+        }
+    }
+
+    void __destroy(node_t *x) {
+        for (auto &e : x->children) __destroy(e.second);
+        delete x;
+    }
+
+   private:
+    node_t *root;
+    size_t nodes = 0;
+    size_t words = 0;
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <random>
+
+/*
+ * 跳表节点层数的随机生成, skiplist 和 concurrent_skiplist 共用.
+ * 每个线程使用自己的 xorshift 随机数发生器, 生成时不访问共享数据.
+ * prob 为 2 的负整数次幂时只需要一个随机数: 末尾连续的 0 的个数服从
+ * 几何分布, 每 bits 个 0 升高一层; 其他 prob 逐层比较
+ * */
+class skiplist_level_generator {
+   public:
+    explicit skiplist_level_generator(float prob = 0.5f, int max_level = 16)
+        : prob(prob), max_level(max_level) {
+        // prob 为 1/2, 1/4, 1/8... 时每 bits 个随机位决定一层
+        for (int b = 1; b <= 8; b++)
+            if (std::fabs(std::ldexp(1.0, -b) - prob) < 1e-6) bits = b;
+    }
+
+    // 1 <= level <= max_level
+    int operator()() const {
+        if (bits > 0) {
+            uint64_t r = next_random() | (1ull << 63);
+            int level = 1 + std::countr_zero(r) / bits;
+            return std::min(level, max_level);
+        }
+        int level = 1;
+        while ((next_random() >> 11) * 0x1.0p-53 < prob && level < max_level)
+            level++;
+        return level;
+    }
+
+    static uint64_t next_random() {
+        thread_local uint64_t state =
+            ((uint64_t)std::random_device{}() << 32 | std::random_device{}()) |
+            1;
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+
+   private:
+    float prob;
+    int max_level;
+    // prob = 2^-bits, 否则为 0
+    int bits = 0;
+};
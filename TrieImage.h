@@ -0,0 +1,445 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "TrieTree.h"
+
+/*
+ * TrieTree/AC_automaton 的二进制快照
+ * 文件中不保存任何指针, 节点之间用下标相互引用, 与加载地址无关, 可以直接
+ * mmap 到内存中原地查询, 多个进程共享同一份 page cache.
+ * 文件布局(本机字节序, 每一段按8字节对齐):
+ *   trie_image_header
+ *   trie_image_node  nodes[node_count]     按BFS顺序, 0 为根节点
+ *   T                labels[edge_count]    每个节点的出边按字符有序
+ *   uint32_t         targets[edge_count]
+ *   uint32_t         patterns[pattern_count]  ac自动机: 模式串编号 -> 节点
+ * */
+constexpr uint32_t TRIE_IMAGE_VERSION = 1;
+constexpr uint32_t TRIE_IMAGE_BYTE_ORDER = 0x01020304;
+// 快照中包含 fail/output 等ac自动机信息
+constexpr uint32_t TRIE_IMAGE_AUTOMATON = 1;
+
+struct trie_image_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t label_size;
+    uint32_t flags;
+    uint64_t node_count;
+    uint64_t edge_count;
+    uint64_t pattern_count;
+    uint64_t nodes_offset;
+    uint64_t labels_offset;
+    uint64_t targets_offset;
+    uint64_t patterns_offset;
+    uint64_t file_size;
+    uint64_t max_length;
+};
+
+struct trie_image_node {
+    uint32_t first_edge;
+    uint32_t edge_count;
+    int32_t count;
+    int32_t length;
+    uint32_t fail;
+    // fail 链上最近的完整模式串节点, 0 表示没有
+    uint32_t output;
+    int32_t id;
+    uint32_t isLeaf;
+};
+
+static constexpr char TRIE_IMAGE_MAGIC[8] = {'T', 'R', 'I', 'E',
+                                             'I', 'M', 'G', '\0'};
+
+inline uint64_t __trie_image_align(uint64_t n) { return (n + 7) & ~7ull; }
+
+template <class T, class node_pointer>
+bool __save_trie_image(node_pointer root,
+                       const std::vector<node_pointer> &patterns,
+                       uint32_t flags, uint64_t max_length,
+                       const std::string &path) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "trie image labels must be trivially copyable");
+    std::vector<trie_image_node> nodes;
+    std::vector<T> labels;
+    std::vector<uint32_t> targets;
+    std::unordered_map<node_pointer, uint32_t> ids{{root, 0}};
+
+    // 按BFS顺序编号, 处理某个节点时比它浅的节点(fail/output)都已经编号
+    std::vector<node_pointer> order{root};
+    std::vector<std::pair<T, node_pointer>> kids;
+    for (size_t i = 0; i < order.size(); i++) {
+        node_pointer x = order[i];
+        kids.clear();
+        for (auto it = x->children.begin(); it != x->children.end(); ++it)
+            if (it->second) kids.emplace_back(it->first, it->second);
+        std::sort(kids.begin(), kids.end(),
+                  [](auto &a, auto &b) { return a.first < b.first; });
+
+        trie_image_node n{};
+        n.first_edge = (uint32_t)labels.size();
+        n.edge_count = (uint32_t)kids.size();
+        n.count = x->count;
+        n.length = x->length;
+        n.isLeaf = x->isLeaf && x->count > 0;
+        n.id = x->id;
+        if (flags & TRIE_IMAGE_AUTOMATON) {
+            n.fail = (i == 0 || !x->fail) ? 0 : ids.at(x->fail);
+            n.output = x->output ? ids.at(x->output) : 0;
+        }
+        for (auto &k : kids) {
+            uint32_t id = (uint32_t)order.size();
+            ids[k.second] = id;
+            order.push_back(k.second);
+            labels.push_back(k.first);
+            targets.push_back(id);
+        }
+        nodes.push_back(n);
+    }
+    std::vector<uint32_t> pattern_ids;
+    for (auto p : patterns) pattern_ids.push_back(ids.at(p));
+
+    trie_image_header h{};
+    std::memcpy(h.magic, TRIE_IMAGE_MAGIC, sizeof(h.magic));
+    h.version = TRIE_IMAGE_VERSION;
+    h.byte_order = TRIE_IMAGE_BYTE_ORDER;
+    h.label_size = sizeof(T);
+    h.flags = flags;
+    h.node_count = nodes.size();
+    h.edge_count = labels.size();
+    h.pattern_count = pattern_ids.size();
+    h.max_length = max_length;
+    h.nodes_offset = __trie_image_align(sizeof(h));
+    h.labels_offset = __trie_image_align(h.nodes_offset +
+                                         nodes.size() * sizeof(nodes[0]));
+    h.targets_offset =
+        __trie_image_align(h.labels_offset + labels.size() * sizeof(T));
+    h.patterns_offset = __trie_image_align(
+        h.targets_offset + targets.size() * sizeof(uint32_t));
+    h.file_size = __trie_image_align(h.patterns_offset +
+                                     pattern_ids.size() * sizeof(uint32_t));
+
+    std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+    if (!ofs) return false;
+    uint64_t pos = 0;
+    auto write = [&](uint64_t offset, const void *data, size_t bytes) {
+        static const char zeros[8] = {};
+        ofs.write(zeros, (std::streamsize)(offset - pos));
+        ofs.write((const char *)data, (std::streamsize)bytes);
+        pos = offset + bytes;
+    };
+    write(0, &h, sizeof(h));
+    write(h.nodes_offset, nodes.data(), nodes.size() * sizeof(nodes[0]));
+    write(h.labels_offset, labels.data(), labels.size() * sizeof(T));
+    write(h.targets_offset, targets.data(), targets.size() * sizeof(uint32_t));
+    write(h.patterns_offset, pattern_ids.data(),
+          pattern_ids.size() * sizeof(uint32_t));
+    write(h.file_size, nullptr, 0);
+    return (bool)ofs;
+}
+
+// 保存一棵 TrieTree 的快照
+template <class T, int Type, T endMark, template <class> class Alloc>
+bool save_trie_image(TrieTree<T, Type, endMark, Alloc> &trie,
+                     const std::string &path) {
+    using node_pointer =
+        typename TrieTree<T, Type, endMark, Alloc>::node_pointer;
+    return __save_trie_image<T>(trie.get_root(), std::vector<node_pointer>{},
+                                0, 0, path);
+}
+
+/**
+ * @brief 保存ac自动机的快照, 需要在 buildAC_automaton 之后调用
+ * @note  快照只保存trie和 fail 指针, 不保存大小写的转移: 不区分大小写的
+ * 自动机(ac_case::ascii/unicode)返回 false, 不写文件
+ */
+template <class T, int Type, T endMark, template <class> class Alloc>
+bool save_trie_image(AC_automaton<T, Type, endMark, Alloc> &ac,
+                     const std::string &path) {
+    if (ac.case_sensitivity() != ac_case::sensitive) return false;
+    using node_pointer =
+        typename AC_automaton<T, Type, endMark, Alloc>::node_pointer;
+    std::vector<node_pointer> patterns;
+    for (size_t i = 0; i < ac.pattern_count(); i++)
+        patterns.push_back(ac.pattern((int)i));
+    return __save_trie_image<T>(ac.get_root(), patterns, TRIE_IMAGE_AUTOMATON,
+                                ac.max_pattern_length(), path);
+}
+
+/*
+ * 只读快照, 直接在映射的内存上查询. 加载时校验文件头和所有下标(线性时间,
+ * 不反序列化也不分配内存), 截断或损坏的文件返回 false
+ * */
+template <class T = char, T endMark = '\0'>
+class trie_image {
+   public:
+    using sequence_type =
+        typename std::conditional<isChar<T>::value, std::basic_string<T>,
+                                  std::vector<T>>::type;
+    using const_reference_list_type = const sequence_type &;
+    using ct_iterator = typename sequence_type::const_iterator;
+    using haystack_type =
+        typename std::conditional<isChar<T>::value, std::basic_string_view<T>,
+                                  std::span<const T>>::type;
+
+    trie_image() {}
+    trie_image(const trie_image &) = delete;
+    trie_image &operator=(const trie_image &) = delete;
+    ~trie_image() { close(); }
+
+    // 映射快照文件, 文件不存在或格式不正确时返回 false
+    bool open(const std::string &path) {
+        close();
+#ifndef _WIN32
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || st.st_size <= 0) {
+            ::close(fd);
+            return false;
+        }
+        void *p = ::mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED,
+                         fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) return false;
+        mapped = p;
+        mapped_size = (size_t)st.st_size;
+        if (!attach(p, mapped_size)) {
+            close();
+            return false;
+        }
+        return true;
+#else
+        std::ifstream ifs(path, std::ios::binary);
+        if (!ifs) return false;
+        buffer.assign(std::istreambuf_iterator<char>(ifs),
+                      std::istreambuf_iterator<char>());
+        return attach(buffer.data(), buffer.size());
+#endif
+    }
+
+    // 在一块已经在内存中的快照上查询, 调用者保证其生命周期
+    bool attach(const void *data, size_t size) {
+        const char *base = (const char *)data;
+        if (size < sizeof(trie_image_header) ||
+            (uintptr_t)base % alignof(trie_image_header) != 0)
+            return false;
+        const trie_image_header *h = (const trie_image_header *)base;
+        if (std::memcmp(h->magic, TRIE_IMAGE_MAGIC, sizeof(h->magic)) != 0 ||
+            h->version != TRIE_IMAGE_VERSION ||
+            h->byte_order != TRIE_IMAGE_BYTE_ORDER ||
+            h->label_size != sizeof(T) || h->file_size != size ||
+            h->node_count == 0)
+            return false;
+        // 按元素个数比较, 避免个数过大时乘法溢出
+        auto fits = [&](uint64_t offset, uint64_t n, size_t elem) {
+            return offset % 8 == 0 && offset <= size &&
+                   n <= (size - offset) / elem;
+        };
+        if (!fits(h->nodes_offset, h->node_count, sizeof(trie_image_node)) ||
+            !fits(h->labels_offset, h->edge_count, sizeof(T)) ||
+            !fits(h->targets_offset, h->edge_count, sizeof(uint32_t)) ||
+            !fits(h->patterns_offset, h->pattern_count, sizeof(uint32_t)) ||
+            h->node_count > UINT32_MAX || h->edge_count > UINT32_MAX)
+            return false;
+
+        const trie_image_node *n =
+            (const trie_image_node *)(base + h->nodes_offset);
+        const uint32_t *t = (const uint32_t *)(base + h->targets_offset);
+        const uint32_t *p = (const uint32_t *)(base + h->patterns_offset);
+        if (!__validate(*h, n, t, p)) return false;
+
+        header = h;
+        nodes = n;
+        labels = (const T *)(base + h->labels_offset);
+        targets = t;
+        patterns = p;
+        return true;
+    }
+
+    void close() {
+#ifndef _WIN32
+        if (mapped) ::munmap(mapped, mapped_size);
+#endif
+        mapped = nullptr;
+        mapped_size = 0;
+        buffer.clear();
+        header = nullptr;
+    }
+
+    bool is_open() const { return header != nullptr; }
+    bool has_automaton() const {
+        return header && (header->flags & TRIE_IMAGE_AUTOMATON);
+    }
+    size_t node_count() const { return header ? header->node_count : 0; }
+    size_t pattern_count() const { return header ? header->pattern_count : 0; }
+    // 编号为 id 的模式串的出现次数, id 不存在时返回 0
+    int pattern_occurrences(int id) const {
+        if (!header || id < 0 || (uint64_t)id >= header->pattern_count)
+            return 0;
+        return nodes[patterns[id]].count;
+    }
+
+    // 查找一个序列/单词是否存在
+    bool search(ct_iterator first, ct_iterator last) const {
+        return count(first, last) > 0;
+    }
+    bool search(const_reference_list_type s) const {
+        return search(s.begin(), s.end());
+    }
+
+    // 统计某个序列/单词重复出现的次数
+    int count(ct_iterator first, ct_iterator last) const {
+        if (!header) return 0;
+        uint32_t x = 0;
+        for (; first != last; first++) {
+            if (*first == endMark) continue;
+            int64_t e = __find_edge(x, *first);
+            if (e < 0) return 0;
+            x = targets[e];
+        }
+        return nodes[x].isLeaf ? nodes[x].count : 0;
+    }
+    int count(const_reference_list_type s) const {
+        return count(s.begin(), s.end());
+    }
+
+    // 获取所有的前缀单词
+    auto prefixWords(const_reference_list_type prefix_str) const {
+        std::vector<sequence_type> words;
+        if (!header) return words;
+        uint32_t x = 0;
+        for (auto c : prefix_str) {
+            if (c == endMark) continue;
+            int64_t e = __find_edge(x, c);
+            if (e < 0) return words;
+            x = targets[e];
+        }
+        sequence_type v = prefix_str;
+        __prefix(x, v, words);
+        return words;
+    }
+
+    /**
+     * @brief 使用快照中的ac自动机扫描文本(overlapping 语义)
+     * @note  visit 返回 false 时停止, 与 AC_automaton::match 报告相同的匹配
+     */
+    template <class F>
+    bool match(haystack_type s, F &&visit) const {
+        if (!has_automaton()) return true;
+        uint32_t x = 0;
+        for (size_t i = 0; i < s.size(); i++) {
+            while (true) {
+                int64_t e = __find_edge(x, s[i]);
+                if (e >= 0) {
+                    x = targets[e];
+                    break;
+                }
+                if (x == 0) break;
+                x = nodes[x].fail;
+            }
+            uint32_t z = nodes[x].isLeaf ? x : nodes[x].output;
+            for (; z != 0; z = nodes[z].output) {
+                ac_match_t m{nodes[z].id, i + 1 - nodes[z].length,
+                             (size_t)nodes[z].length};
+                if constexpr (std::is_same_v<
+                                  std::invoke_result_t<F &, const ac_match_t &>,
+                                  bool>) {
+                    if (!visit(m)) return false;
+                } else {
+                    visit(m);
+                }
+            }
+        }
+        return true;
+    }
+
+   private:
+    /**
+     * @brief 校验所有下标, 之后的查询不再做边界检查
+     * @note  一次遍历所有节点和边, 不分配内存. 要求快照是 save 写出的
+     * BFS 布局: 各节点的出边按节点顺序连续存放, 第 e 条边指向节点 e + 1,
+     * 因此每个非根节点恰好是一条边的终点, 孩子的编号大于父节点.
+     * ac自动机中 length 为深度, fail/output 的编号和深度都小于当前节点,
+     * 保证沿 fail/output 链的循环一定结束, 匹配的起点不会越过文本开头
+     */
+    static bool __validate(const trie_image_header &h,
+                           const trie_image_node *nodes,
+                           const uint32_t *targets, const uint32_t *patterns) {
+        bool automaton = h.flags & TRIE_IMAGE_AUTOMATON;
+        if (h.edge_count + 1 != h.node_count) return false;
+        if (automaton && nodes[0].length != 0) return false;
+        uint64_t next_edge = 0;
+        for (uint64_t x = 0; x < h.node_count; x++) {
+            const trie_image_node &n = nodes[x];
+            if (n.first_edge != next_edge ||
+                (uint64_t)n.first_edge + n.edge_count > h.edge_count ||
+                n.count < 0 || n.isLeaf > 1)
+                return false;
+            next_edge += n.edge_count;
+            for (uint32_t e = n.first_edge; e < n.first_edge + n.edge_count;
+                 e++) {
+                if (targets[e] != e + 1 || targets[e] <= x) return false;
+                if (automaton && nodes[targets[e]].length != n.length + 1)
+                    return false;
+            }
+            if (!automaton) continue;
+            if (x == 0 ? n.output != 0
+                       : n.fail >= x || n.output >= x ||
+                             nodes[n.fail].length >= n.length ||
+                             nodes[n.output].length >= n.length)
+                return false;
+        }
+        for (uint64_t i = 0; i < h.pattern_count; i++)
+            if (patterns[i] >= h.node_count) return false;
+        return true;
+    }
+
+    int64_t __find_edge(uint32_t x, T c) const {
+        const trie_image_node &n = nodes[x];
+        const T *first = labels + n.first_edge;
+        const T *last = first + n.edge_count;
+        const T *it = std::lower_bound(first, last, c);
+        if (it == last || *it != c) return -1;
+        return it - labels;
+    }
+
+    void __prefix(uint32_t x, sequence_type &v,
+                  std::vector<sequence_type> &words) const {
+        const trie_image_node &n = nodes[x];
+        if (n.isLeaf)
+            for (int k = 0; k < n.count; k++) words.push_back(v);
+        for (uint32_t e = n.first_edge; e < n.first_edge + n.edge_count; e++) {
+            v.push_back(labels[e]);
+            __prefix(targets[e], v, words);
+            v.pop_back();
+        }
+    }
+
+   private:
+    void *mapped = nullptr;
+    size_t mapped_size = 0;
+    std::vector<char> buffer;
+
+    const trie_image_header *header = nullptr;
+    const trie_image_node *nodes = nullptr;
+    const T *labels = nullptr;
+    const uint32_t *targets = nullptr;
+    const uint32_t *patterns = nullptr;
+};
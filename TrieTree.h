@@ -1,16 +1,28 @@
 #pragma once
 
 #include <algorithm>
-#include <codecvt>
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <iostream>
-#include <locale>
 #include <map>
 #include <memory>
+#include <optional>
 #include <queue>
+#include <span>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <tuple>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
+#include "NodeAllocator.h"
+#include "Glob.h"
+#include "art_map.h"
+#include "Utf8.h"
 #include "skiplist.h"
 /*
  Trie 树支持以下操作：
@@ -20,6 +32,7 @@
 * 4.用于AC自动机的辅助数据结构
 *
 * 按照节点的存储结构，分为有序Trie和无序Trie
+* Type: 0 map, 1 unordered_map, 2 skiplist, 3 art_map(单字节字符)
 * */
 
 template <class T, int Type>
@@ -29,7 +42,7 @@ struct TrieNodeData {
     using node_type = typename std::tuple_element_t<
         Type,
         std::tuple<std::map<T, self_type *>, std::unordered_map<T, self_type *>,
-                   skiplist<T, self_type *>>>;
+                   skiplist<T, self_type *>, art_map<T, self_type *>>>;
 
     using iterator = typename node_type::iterator;
     using const_iterator = typename node_type::const_iterator;
@@ -40,8 +53,14 @@ struct TrieNodeData {
     int count;
     // 记录一个单词/序列的长度
     int length;
+    // 以该节点为根的子树中(包括自身)单词/序列出现次数的最大值, 用于 top-K 补全
+    int maxCount = 0;
     // fail指针,用于构建ac自动机
     self_type *fail;
+    // 输出指针: fail 链上最近的一个完整单词/序列节点, 用于ac自动机
+    self_type *output = nullptr;
+    // ac自动机中模式串的编号, 不是模式串时为 -1
+    int id = -1;
     // 孩子节点有序trie/无序trie
     node_type children;
 
@@ -53,6 +72,7 @@ struct TrieNodeData {
         isLeaf = other.isLeaf;
         count = other.count;
         length = other.length;
+        maxCount = other.maxCount;
         fail = nullptr;
     }
 };
@@ -70,17 +90,68 @@ struct isChar<wchar_t> {
     static constexpr bool value = true;
 };
 
-// convert wstring to string
-std::ostream &operator<<(std::ostream &out, basic_string<wchar_t> ws) {
-    std::wstring_convert<std::codecvt_utf8<wchar_t>> convert;
-    out << convert.to_bytes(ws);
-    return out;
+// 以 UTF-8 输出宽字符串
+inline std::ostream &operator<<(std::ostream &out, std::wstring_view ws) {
+    return out << utf8::encode(ws);
 }
+inline std::ostream &operator<<(std::ostream &out, const std::wstring &ws) {
+    return out << std::wstring_view(ws);
+}
+
+/*
+ * 热路径计数器, 只有定义了宏 TRIETREE_STATS 时才计数, 否则计数语句被编译掉.
+ * 使用 relaxed 原子操作, 多线程并行扫描时也可以计数
+ * */
+struct trie_counters {
+    // search/count 的调用次数(包括批量查找中的每个 key)
+    std::atomic<uint64_t> searches{0};
+    // 查找孩子节点的次数
+    std::atomic<uint64_t> child_lookups{0};
+    // ac自动机的状态转移次数, 每个输入字符一次
+    std::atomic<uint64_t> transitions{0};
+    // 沿 fail 指针跳转的次数, 只有未编译的ac自动机才会跳转
+    std::atomic<uint64_t> fail_hops{0};
+    // ac自动机输出的匹配个数
+    std::atomic<uint64_t> matches{0};
+
+    void reset() {
+        for (auto *c : {&searches, &child_lookups, &transitions, &fail_hops,
+                        &matches})
+            c->store(0, std::memory_order_relaxed);
+    }
+};
+
+#ifdef TRIETREE_STATS
+#define TRIETREE_COUNT(counter, n) \
+    ((counter).fetch_add((n), std::memory_order_relaxed))
+#else
+#define TRIETREE_COUNT(counter, n) ((void)0)
+#endif
+
+// trie树的结构统计, 由 stats() 遍历整棵树计算
+struct trie_stats {
+    // 节点数, 包括根节点
+    size_t nodes = 0;
+    // 不同的单词/序列个数, 以及它们出现的总次数
+    size_t words = 0;
+    size_t occurrences = 0;
+    // 节点的最大深度, 单词/序列节点的平均深度(即平均长度)
+    size_t max_depth = 0;
+    double avg_word_depth = 0;
+    // 节点和孩子容器占用的内存(估计值), 以及平均每个单词/序列的字节数
+    size_t bytes = 0;
+    double bytes_per_word = 0;
+    // [d]: 深度为 d 的节点数
+    std::vector<size_t> depth_histogram;
+    // [k]: 恰好有 k 个孩子的节点数
+    std::vector<size_t> fanout_histogram;
+};
 
-template <class T = char, int Type = 0, T endMark = '\0'>
+template <class T = char, int Type = 0, T endMark = '\0',
+          template <class> class Alloc = heap_node_allocator>
 class TrieTree {
    public:
-    using self_type = TrieTree<T, Type, endMark>;
+    using self_type = TrieTree<T, Type, endMark, Alloc>;
     using self_reference_type = self_type &;
     using self_const_reference_type = const self_type &;
 
@@ -89,6 +160,8 @@ class TrieTree {
     using node_pointer_ref = node_pointer &;
     using node_itertor = typename node_type::iterator;
     using node_const_iterator = typename node_type::const_iterator;
+    // 节点分配策略, 根节点总是单独分配
+    using allocator_type = Alloc<node_type>;
 
     using sequence_type =
         typename std::conditional<isChar<T>::value, std::basic_string<T>,
@@ -99,51 +172,113 @@ class TrieTree {
     using t_iterator = typename sequence_type::iterator;
     using ct_iterator = typename sequence_type::const_iterator;
 
+    // 批量查找时同时前进的 key 的个数
+    static constexpr size_t BATCH_GROUP = 16;
+
     TrieTree() { root = new node_type(); }
 
     ~TrieTree() {
-        clear(root);
+        clear();
         if (root) {
             delete root;
             root = nullptr;
         }
     }
 
-    // trie树迭代器
+    /**
+     * trie树迭代器, 按深度优先(孩子容器的顺序)依次产生每个单词/序列,
+     * 重复出现的单词产生 count 次. 使用显式的栈遍历节点, 当前的单词保存在
+     * 迭代器内部复用的缓冲区中, 解引用得到它的引用, 递增时不分配内存.
+     * 遍历过程中修改trie会使迭代器失效
+     * */
     class iterator {
        public:
-        iterator(typename std::vector<sequence_type>::iterator first) {
-            it = first;
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = sequence_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const sequence_type *;
+        using reference = const sequence_type &;
+
+        iterator() {}
+        explicit iterator(node_pointer root) {
+            stack.push_back(frame_t{root->children.begin(),
+                                    root->children.end()});
+            __next();
+        }
+        bool operator==(const iterator &it) const {
+            return cur == it.cur && remaining == it.remaining;
         }
-        ~iterator() {}
-        bool operator!=(iterator it) { return this->it != it.it; }
+        bool operator!=(const iterator &it) const { return !(*this == it); }
         iterator operator++(int) {
-            iterator old(it);
-            it++;
+            iterator old(*this);
+            ++*this;
             return old;
         }
         iterator &operator++() {
-            it++;
+            if (--remaining == 0) __next();
             return *this;
         }
-        sequence_type &operator*() { return *it; }
-        sequence_type *operator->() { return &*it; }
+        reference operator*() const { return key; }
+        pointer operator->() const { return &key; }
 
        private:
-        typename std::vector<sequence_type>::iterator it;
+        // 正在遍历孩子的节点, 栈的深度比 key 的长度大 1
+        struct frame_t {
+            node_itertor it, end;
+        };
+
+        // 前进到下一个单词/序列节点, 没有时变为 end()
+        void __next() {
+            while (!stack.empty()) {
+                frame_t &top = stack.back();
+                if (!(top.it != top.end)) {
+                    stack.pop_back();
+                    if (!key.empty()) key.pop_back();
+                    continue;
+                }
+                T c = top.it->first;
+                node_pointer y = top.it->second;
+                ++top.it;
+                if (!y) continue;
+                key.push_back(c);
+                stack.push_back(
+                    frame_t{y->children.begin(), y->children.end()});
+                if (y->isLeaf && y->count > 0) {
+                    cur = y;
+                    remaining = y->count;
+                    return;
+                }
+            }
+            cur = nullptr;
+            remaining = 0;
+        }
+
+        std::vector<frame_t> stack;
+        sequence_type key;
+        node_pointer cur = nullptr;
+        int remaining = 0;
     };
 
-    iterator begin() {
-        get();
-        return iterator(__vcLs.begin());
-    }
-    iterator end() { return iterator(__vcLs.end()); }
+    iterator begin() { return iterator(root); }
+    iterator end() { return iterator(); }
 
-    // clone TrieTree
+    // clone TrieTree, 逐个节点复制结构
     auto clone() {
         std::shared_ptr<self_type> self = std::make_shared<self_type>();
-        for (auto s : get()) {
-            self->insert(s);
+        __copy_node(self->root, root);
+        std::vector<std::pair<node_pointer, node_pointer>> stack{
+            {self->root, root}};
+        while (!stack.empty()) {
+            auto [to, from] = stack.back();
+            stack.pop_back();
+            for (auto it = from->children.begin(); it != from->children.end();
+                 ++it) {
+                if (!it->second) continue;
+                node_pointer y = self->alloc.create();
+                __copy_node(y, it->second);
+                self->__append_child(to, it->first, y);
+                stack.emplace_back(y, it->second);
+            }
         }
         return self;
     }
@@ -152,35 +287,120 @@ class TrieTree {
     node_pointer insert(ct_iterator first, ct_iterator last) {
         auto x = root;
         int length = last - first;
-        for (; first != last; first++) {
-            if (*first == endMark) continue;
-
-            if (x->children.find(*first) == x->children.end()) {
-                x->children[*first] = new node_type();
+        // 插入后路径上每个节点的子树中至少有一个出现次数为 1 的单词
+        x->maxCount = std::max(x->maxCount, 1);
+        for (auto it = first; it != last; it++) {
+            if (*it == endMark) continue;
+            // 查找和插入只访问一次孩子容器
+            auto [child, inserted] = x->children.try_emplace(*it, nullptr);
+            if (inserted) {
+                child->second = alloc.create();
                 // fail指针,用于构建AC自动机
-                x->children[*first]->fail = root;
+                child->second->fail = root;
             }
-            x = x->children[*first];
+            x = child->second;
+            x->maxCount = std::max(x->maxCount, 1);
         }
         x->length = length;
         x->isLeaf = true;
         x->count++;
+        // 重复插入的单词需要再沿路径更新一次
+        if (x->count > 1) __raise_max(first, last, x->count);
         return x;
     }
     node_pointer insert(const_reference_list_type s) {
         return insert(s.begin(), s.end());
     }
 
+    /**
+     * @brief 由有序的序列/单词批量构建trie
+     * @note  每个序列沿用与前一个序列的最长公共前缀上的节点, 其余部分的节点
+     * 都是新建的, 直接追加到孩子容器中而不再查找. 遇到无序的序列或含有
+     * endMark 的序列时退化为普通的 insert. [first, last) 需要是前向迭代器,
+     * 每插入一个序列调用一次 inserted(node_pointer).
+     * 不预先为孩子容器分配空间: 节点的孩子数要看到之后的序列才知道, 只有
+     * unordered_map 支持 reserve, 而大多数节点只有一个孩子, 按猜测预留
+     * 只会浪费内存; 节点本身可以由 arena_node_allocator 批量分配
+     * @retval 插入的序列个数
+     */
+    template <class It, class F>
+    size_t insert_sorted(It first, It last, F &&inserted) {
+        // path[i] 为前一个序列的前 i 个字符对应的节点
+        std::vector<node_pointer> path{root};
+        size_t n = 0;
+        It prev = last;
+        for (; first != last; ++first, ++n) {
+            const sequence_type &s = *first;
+            size_t lcp = 0;
+            bool sorted = true;
+            if (prev != last) {
+                const sequence_type &p = *prev;
+                size_t m = std::min(p.size(), s.size());
+                while (lcp < m && p[lcp] == s[lcp]) lcp++;
+                // 与 sequence_type 的比较一致: 字符按 char_traits 比较
+                // (char 按无符号字节), 与 std::sort 排好的 UTF-8 顺序相同
+                if (lcp == m)
+                    sorted = p.size() <= s.size();
+                else if constexpr (isChar<T>::value)
+                    sorted = std::char_traits<T>::lt(p[lcp], s[lcp]);
+                else
+                    sorted = p[lcp] < s[lcp];
+            }
+            // path 上的前缀来自前一个序列, 已经检查过 endMark
+            lcp = std::min(lcp, path.size() - 1);
+            if (!sorted ||
+                std::find(s.begin() + lcp, s.end(), endMark) != s.end()) {
+                inserted(insert(s));
+                path.resize(1);
+                prev = first;
+                continue;
+            }
+            path.resize(lcp + 1);
+
+            node_pointer x = path.back();
+            // 一旦新建了节点, 之后的节点都不需要查找
+            bool fresh = false;
+            for (size_t i = lcp; i < s.size(); i++) {
+                node_pointer y = nullptr;
+                if (!fresh) {
+                    auto it = x->children.find(s[i]);
+                    if (it != x->children.end()) y = it->second;
+                }
+                if (!y) {
+                    y = alloc.create();
+                    // fail指针,用于构建AC自动机
+                    y->fail = root;
+                    __append_child(x, s[i], y);
+                    fresh = true;
+                }
+                path.push_back(y);
+                x = y;
+            }
+            x->length = (int)s.size();
+            x->isLeaf = true;
+            x->count++;
+            for (auto y : path) y->maxCount = std::max(y->maxCount, x->count);
+            inserted(x);
+            prev = first;
+        }
+        return n;
+    }
+    template <class It>
+    size_t insert_sorted(It first, It last) {
+        return insert_sorted(first, last, [](node_pointer) {});
+    }
+
     // 查找一个序列/单词是否存在
     node_pointer search(ct_iterator first, ct_iterator last) {
         if (root == nullptr) return nullptr;
+        TRIETREE_COUNT(hot_counters.searches, 1);
         auto x = root;
-        for (; first != last; first++) {
+        for (; x && first != last; first++) {
             if (*first == endMark) continue;
-            if (x->children.find(*first) == x->children.end()) return nullptr;
-            x = x->children[*first];
+            TRIETREE_COUNT(hot_counters.child_lookups, 1);
+            x = __child(x, *first);
         }
-        return x->isLeaf ? x : nullptr;
+        return x && x->isLeaf ? x : nullptr;
     }
     template <class C>
     node_pointer search(const C &c) {
@@ -191,110 +411,111 @@ class TrieTree {
         return search(s.begin(), s.end());
     }
 
+    /**
+     * @brief 批量查找, nodes[i] 为 keys[i] 的 search 结果
+     * @note  每 BATCH_GROUP 个 key 为一组交替前进: 每一轮每个 key 只下降
+     * 一层, 并预取下一层的节点, 一组 key 的访存延迟相互重叠, 而不是逐个
+     * key 地等待每一次指针跳转
+     */
+    void search_batch(std::span<const sequence_type> keys,
+                      std::span<node_pointer> nodes) {
+        __batch(keys, [&](size_t i, node_pointer x) {
+            nodes[i] = x && x->isLeaf ? x : nullptr;
+        });
+    }
+    std::vector<node_pointer> search_batch(
+        std::span<const sequence_type> keys) {
+        std::vector<node_pointer> nodes(keys.size());
+        search_batch(keys, nodes);
+        return nodes;
+    }
+
+    // 批量统计, counts[i] 为 keys[i] 的 count 结果
+    void count_batch(std::span<const sequence_type> keys,
+                     std::span<int> counts) {
+        __batch(keys, [&](size_t i, node_pointer x) {
+            counts[i] = x && x->isLeaf ? x->count : 0;
+        });
+    }
+    std::vector<int> count_batch(std::span<const sequence_type> keys) {
+        std::vector<int> counts(keys.size());
+        count_batch(keys, counts);
+        return counts;
+    }
+
     // 前缀匹配
     node_pointer prefix_find(const_reference_list_type s) {
         if (root == nullptr) return nullptr;
         auto x = root;
-        for (auto it = s.begin(); it != s.end(); it++) {
-            if (*it == endMark) continue;
-            if (x->children.find(*it) == x->children.end()) return nullptr;
-            x = x->children[*it];
-        }
+        for (auto it = s.begin(); x && it != s.end(); it++)
+            if (*it != endMark) x = __child(x, *it);
         return x;
     }
 
-    // 删除一个序列/单词
-    bool erase(node_pointer_ref x, ct_iterator first, ct_iterator last) {
-        if (!x) return false;
-        if (*first != endMark) {
-            if (x->children.find(*first) != x->children.end()) {
-                if (erase(x->children[*first], next(first, 1), last) &&
-                    x->isLeaf == false) {
-                    // 没有孩子节点，则删除
-                    if (!hasChildren(x) && x->count == 0) {
-                        x->children.erase(*first);
-                        delete x;
-                        x = nullptr;
-                        return true;
-                    } else {
-                        x->children.erase(*first);
-                        return false;
-                    }
-                } else {
-                    // 如果当前节点没有孩子节点，则从哈希表/红黑树中删除多余的
-                    // 不存在的 key-value
-                    if (!hasChildren(x)) {
-                        x->children.erase(*first);
-                    }
-                }
-            }
+    /**
+     * @brief 删除一次出现, 次数减为 0 时自底向上删除既不是单词也没有孩子的
+     * 节点, 并重新计算路径上的 maxCount. 根节点不会被删除
+     * @retval 序列/单词存在时返回 true
+     */
+    bool erase(ct_iterator first, ct_iterator last) {
+        // path[i]: 第 i 个字符所在的父节点和指向孩子的迭代器
+        std::vector<std::pair<node_pointer, node_itertor>> path;
+        node_pointer x = root;
+        for (; first != last; first++) {
+            if (*first == endMark) continue;
+            auto it = x->children.find(*first);
+            if (it == x->children.end() || !it->second) return false;
+            path.emplace_back(x, it);
+            x = it->second;
         }
-        // 叶子节点
-        if (*first == endMark && x->isLeaf) {
-            x->count--;
-            // 只有在 count=0 时才真正的删除序列/单词
-            if (!hasChildren(x) && x->count == 0) {
-                delete x;
-                x = nullptr;
-                return true;
-            } else {
-                if (x->count == 0) x->isLeaf = false;
-                return false;
-            }
+        if (!x->isLeaf || x->count == 0) return false;
+        if (--x->count == 0) x->isLeaf = false;
+        while (!path.empty() && !x->isLeaf && x->children.empty()) {
+            auto [parent, it] = path.back();
+            path.pop_back();
+            __erase_child(parent, it);
+            alloc.destroy(x);
+            x = parent;
         }
-        return false;
+        // x 及其祖先仍然存在, 子树中的单词可能变少了
+        for (size_t i = path.size() + 1; i-- > 0;) {
+            x->maxCount = x->isLeaf ? x->count : 0;
+            for (auto it = x->children.begin(); it != x->children.end(); ++it)
+                if (it->second)
+                    x->maxCount = std::max(x->maxCount, it->second->maxCount);
+            if (i > 0) x = path[i - 1].first;
+        }
+        return true;
     }
     bool erase(const_reference_list_type s) {
-        return erase(root, s.begin(), s.end());
+        return erase(s.begin(), s.end());
     }
 
     // 统计某个序列/单词重复出现的次数
     int count(ct_iterator first, ct_iterator last) {
-        if (!root) return 0;
-        auto x = root;
-        for (; first != last; first++) {
-            if (*first == endMark) continue;
-            if (x->children.find(*first) != x->children.end()) {
-                x = x->children[*first];
-            } else {
-                return 0;
-            }
-        }
         // 只有到达叶子节点才可以得到正确的count
-        if (x->isLeaf) return x->count;
-        return 0;
+        node_pointer x = search(first, last);
+        return x ? x->count : 0;
     }
     int count(const_reference_list_type c) { return count(c.begin(), c.end()); }
 
     // 获取当前trie树所有的单词/序列
-    void get(node_pointer x, sequence_type &v) {
-        if (!x) return;
-        for (auto it : x->children) {
-            v.push_back(it.first);
-            if (it.second->isLeaf) {
-                for (int i = 0; i < it.second->count; i++) __vcLs.push_back(v);
-            }
-            get(it.second, v);
-            v.pop_back();
-        }
-    }
-    decltype(auto) get() {
-        __vcLs.clear();
-        sequence_type v;
-        get(root, v);
-        return __vcLs;
+    std::vector<sequence_type> get() {
+        std::vector<sequence_type> words;
+        for (auto it = begin(); it != end(); ++it) words.push_back(*it);
+        return words;
     }
     // 所有匹配的前缀单词
-    void __prefix(node_pointer x, sequence_type s,
+    void __prefix(node_pointer x, sequence_type &s,
                   std::vector<sequence_type> &words) {
         if (!x) return;
-        for (auto it : x->children) {
-            s.push_back(it.first);
-            if (it.second->isLeaf) {
+        for (auto it = x->children.begin(); it != x->children.end(); ++it) {
+            s.push_back(it->first);
+            if (it->second->isLeaf) {
                 // 如果有重复出现
-                for (int i = 0; i < it.second->count; i++) words.push_back(s);
+                for (int i = 0; i < it->second->count; i++) words.push_back(s);
             }
-            __prefix(it.second, s, words);
+            __prefix(it->second, s, words);
             s.pop_back();
         }
     }
@@ -312,56 +533,484 @@ class TrieTree {
         if (x->isLeaf) {
             for (int i = 0; i < x->count; i++) words.push_back(prefix_str);
         }
-        __prefix(x, prefix_str, words);
+        sequence_type s = prefix_str;
+        __prefix(x, s, words);
         return words;
     }
 
+    /**
+     * @brief 出现次数最多的 k 个以 prefix_str 为前缀的单词(top-K 补全)
+     * @note  按子树中的最大出现次数 maxCount 做最优优先搜索: 优先队列中的
+     * 节点以 maxCount 为上界, 单词以 count 为键, 弹出的单词一定不小于剩余
+     * 的所有单词, 取够 k 个即停止, 不需要遍历整个子树. 路径只记录在
+     * 一个父指针数组中, 只为结果拼接单词
+     * @retval (单词, 出现次数), 按出现次数从大到小, 次数相同时按入队先后
+     */
+    std::vector<std::pair<sequence_type, int>> topK(
+        const_reference_list_type prefix_str, size_t k) {
+        std::vector<std::pair<sequence_type, int>> result;
+        auto x = prefix_find(prefix_str);
+        if (!x || k == 0 || x->maxCount == 0) return result;
+
+        // entries[i]: 第 i 个入队节点的父节点下标和边上的字符
+        std::vector<std::pair<size_t, T>> entries{{SIZE_MAX, T()}};
+        std::vector<node_pointer> nodes{x};
+        std::priority_queue<topk_item_t> queue;
+        queue.push(topk_item_t{x->maxCount, false, 0});
+        while (!queue.empty() && result.size() < k) {
+            topk_item_t top = queue.top();
+            queue.pop();
+            if (top.word) {
+                sequence_type s = prefix_str;
+                size_t n = s.size();
+                for (size_t j = top.index; j != 0; j = entries[j].first)
+                    s.push_back(entries[j].second);
+                std::reverse(s.begin() + n, s.end());
+                result.emplace_back(std::move(s), top.priority);
+                continue;
+            }
+            node_pointer y = nodes[top.index];
+            if (y->isLeaf && y->count > 0)
+                queue.push(topk_item_t{y->count, true, top.index});
+            for (auto it = y->children.begin(); it != y->children.end();
+                 ++it) {
+                if (!it->second || it->second->maxCount == 0) continue;
+                entries.emplace_back(top.index, it->first);
+                nodes.push_back(it->second);
+                queue.push(
+                    topk_item_t{it->second->maxCount, false, nodes.size() - 1});
+            }
+        }
+        return result;
+    }
+
+    /**
+     * @brief 与 s 的编辑距离(Levenshtein)不超过 k 的所有单词
+     * @note  深度优先遍历trie, 每个孩子在父节点的 DP 行上计算一行:
+     * row[j] 为根到该节点的路径与 s 的前 j 个字符的编辑距离. 一行的最小值
+     * 超过 k 时子树中的单词都不可能在距离 k 之内, 剪掉整个子树. 公共前缀
+     * 的行只计算一次, 耗时与访问的节点数成正比, 与单词总数无关
+     * @param  visit: visit(单词, 出现次数, 编辑距离)
+     */
+    template <class F>
+    void fuzzy(const_reference_list_type s, size_t k, F &&visit) {
+        TRIETREE_COUNT(hot_counters.searches, 1);
+        size_t m = s.size();
+        // 第 d 行是深度 d 的节点的 DP 行, 访问更深的节点时再扩大.
+        // 不按 k 预分配: k 可以任意大, 而深度受 trie 的高度限制
+        std::vector<size_t> rows(m + 1);
+        for (size_t j = 0; j <= m; j++) rows[j] = j;
+        sequence_type path;
+        if (root->isLeaf && root->count > 0 && m <= k)
+            visit(std::as_const(path), root->count, m);
+        __fuzzy(root, 0, s, k, rows, path, visit);
+    }
+    // 结果按遍历顺序(有序的孩子容器时按字典序), (单词, 出现次数)
+    std::vector<std::pair<sequence_type, int>> fuzzy(
+        const_reference_list_type s, size_t k) {
+        std::vector<std::pair<sequence_type, int>> result;
+        fuzzy(s, k, [&](const sequence_type &w, int count, size_t) {
+            result.emplace_back(w, count);
+        });
+        return result;
+    }
+
+    /**
+     * @brief 匹配通配符模式(?, *, [a-f], 见 Glob.h)的所有单词,
+     * 每个单词调用一次 visit(单词, 出现次数)
+     * @note  第一个通配符之前的字面前缀直接沿trie向下查找, 之后深度优先
+     * 遍历子树, 每条边在惰性 DFA 上转移一次(同一状态集合和字符的转移只计算
+     * 一次), 到达死状态时剪掉整个子树. 耗时取决于与模式相交的子树大小,
+     * 与单词总数无关. visit 返回 false 时立即停止
+     * @retval 遍历完成时返回 true, 被 visit 提前终止时返回 false
+     */
+    template <class F>
+    bool glob(const_reference_list_type pattern, F &&visit) {
+        static_assert(isChar<T>::value, "glob() only supports char/wchar_t");
+        TRIETREE_COUNT(hot_counters.searches, 1);
+        glob_pattern<T> g(pattern);
+        sequence_type key = g.literal_prefix();
+        node_pointer x = prefix_find(key);
+        if (!x) return true;
+        int state = g.start();
+        for (auto c : key) state = g.next(state, c);
+        return __glob(x, state, g, key, visit);
+    }
+    // 结果按遍历顺序(有序的孩子容器时按字典序), (单词, 出现次数)
+    std::vector<std::pair<sequence_type, int>> glob(
+        const_reference_list_type pattern) {
+        std::vector<std::pair<sequence_type, int>> result;
+        glob(pattern, [&](const sequence_type &w, int count) {
+            result.emplace_back(w, count);
+        });
+        return result;
+    }
+
     // 清空TrieTree
     void clear(node_pointer_ref x) {
         if (!x) return;
         for (auto &i : x->children) {
             clear(i.second);
             // 回溯过程中删除节点
-            delete i.second;
+            alloc.destroy(i.second);
             i.second = nullptr;
         }
     }
     void clear() {
-        clear(root);
-        root->children.clear();
+        root->maxCount = 0;
+        if constexpr (allocator_type::bulk_release) {
+            // 内存池一次性回收所有节点
+            root->children.clear();
+            alloc.release();
+        } else {
+            clear(root);
+            root->children.clear();
+        }
     }
     node_pointer_ref get_root() { return root; }
 
+    /**
+     * @brief 结构统计: 节点数, 单词数, 深度和扇出的分布, 内存占用
+     * @note  遍历整棵树, 耗时与节点数成正比. 内存按节点大小加上孩子容器
+     * 的堆内存估计, 标准库容器按常见实现的节点布局估计
+     */
+    trie_stats stats() const {
+        trie_stats st;
+        size_t word_depth = 0;
+        std::vector<std::pair<node_pointer, size_t>> stack{{root, 0}};
+        while (!stack.empty()) {
+            auto [x, depth] = stack.back();
+            stack.pop_back();
+            st.nodes++;
+            st.bytes += sizeof(node_type) + __children_bytes(x);
+            if (x->isLeaf && x->count > 0) {
+                st.words++;
+                st.occurrences += x->count;
+                word_depth += depth;
+            }
+            st.max_depth = std::max(st.max_depth, depth);
+            if (st.depth_histogram.size() <= depth)
+                st.depth_histogram.resize(depth + 1);
+            st.depth_histogram[depth]++;
+            size_t fanout = x->children.size();
+            if (st.fanout_histogram.size() <= fanout)
+                st.fanout_histogram.resize(fanout + 1);
+            st.fanout_histogram[fanout]++;
+            for (auto it = x->children.begin(); it != x->children.end(); ++it)
+                if (it->second) stack.emplace_back(it->second, depth + 1);
+        }
+        if (st.words) {
+            st.avg_word_depth = (double)word_depth / st.words;
+            st.bytes_per_word = (double)st.bytes / st.words;
+        }
+        return st;
+    }
+
+    // 热路径计数器, 定义了 TRIETREE_STATS 时才计数
+    const trie_counters &counters() const { return hot_counters; }
+    void reset_counters() { hot_counters.reset(); }
+
    protected:
-    // 是否有孩子节点
-    bool hasChildren(node_pointer x) {
-        for (auto it : x->children)
-            if (it.second) return true;
-        return false;
+    // 追加一个新的孩子节点, 有序输入时 c 大于 x 已有的所有孩子
+    void __append_child(node_pointer x, const T &c, node_pointer y) {
+        if constexpr (Type == 0)
+            x->children.emplace_hint(x->children.end(), c, y);
+        else if constexpr (Type == 1 || Type == 3)
+            x->children.emplace(c, y);
+        else if constexpr (Type == 2)
+            x->children.insert(c, y);
+        else
+            x->children[c] = y;
+    }
+
+    // 字符 c 对应的孩子, 只查找一次, 没有时返回 nullptr
+    static node_pointer __child(node_pointer x, const T &c) {
+        auto it = x->children.find(c);
+        return it != x->children.end() ? it->second : nullptr;
+    }
+
+    // 孩子容器占用的堆内存字节数
+    static size_t __children_bytes(node_pointer x) {
+        using value_type = std::pair<const T, node_pointer>;
+        if constexpr (Type == 0)
+            // 红黑树节点: 颜色和三个指针
+            return x->children.size() *
+                   (sizeof(value_type) + 4 * sizeof(void *));
+        else if constexpr (Type == 1)
+            // 单链表节点和桶数组
+            return x->children.size() * (sizeof(value_type) + sizeof(void *)) +
+                   x->children.bucket_count() * sizeof(void *);
+        else
+            return x->children.memory_bytes();
+    }
+
+    // 删除 it 指向的孩子, 跳表和 art_map 的迭代器不支持删除, 按字符删除
+    void __erase_child(node_pointer x, node_itertor it) {
+        if constexpr (Type == 0 || Type == 1)
+            x->children.erase(it);
+        else
+            x->children.erase(it->first);
+    }
+
+    static void __copy_node(node_pointer to, node_pointer from) {
+        to->isLeaf = from->isLeaf;
+        to->count = from->count;
+        to->length = from->length;
+        to->maxCount = from->maxCount;
+        to->id = from->id;
+    }
+
+    // 重复插入后, 将路径上的 maxCount 提高到 c
+    void __raise_max(ct_iterator first, ct_iterator last, int c) {
+        node_pointer x = root;
+        x->maxCount = std::max(x->maxCount, c);
+        for (; first != last; first++) {
+            if (*first == endMark) continue;
+            x = x->children.find(*first)->second;
+            x->maxCount = std::max(x->maxCount, c);
+        }
+    }
+
+    // x 对应 DFA 状态 state, key 为根到 x 的路径
+    template <class F>
+    bool __glob(node_pointer x, int state, glob_pattern<T> &g,
+                sequence_type &key, F &visit) {
+        if (x->isLeaf && x->count > 0 && g.accepting(state)) {
+            if constexpr (std::is_same_v<std::invoke_result_t<
+                                             F &, const sequence_type &, int>,
+                                         bool>) {
+                if (!visit(std::as_const(key), x->count)) return false;
+            } else {
+                visit(std::as_const(key), x->count);
+            }
+        }
+        for (auto it = x->children.begin(); it != x->children.end(); ++it) {
+            if (!it->second) continue;
+            TRIETREE_COUNT(hot_counters.child_lookups, 1);
+            int next = g.next(state, it->first);
+            if (next == glob_pattern<T>::DEAD) continue;
+            key.push_back(it->first);
+            if (!__glob(it->second, next, g, key, visit)) return false;
+            key.pop_back();
+        }
+        return true;
+    }
+
+    /**
+     * @brief 计算 x 的每个孩子的 DP 行(第 depth + 1 行), 最小值不超过 k 时
+     * 继续向下
+     * @note  row[j] 不小于 |d - j|, 只计算 |d - j| <= k 的对角带, 带外
+     * 相邻的格子记为 k + 1, 每行的代价为 O(k) 而不是 O(|s|).
+     * 第 d 行的值不超过 m + d, 超过 m + d 的 k 与 m + d 的结果相同,
+     * 先截断 k, 避免很大的 k 在 k + 1 和 d + k 处溢出
+     */
+    template <class F>
+    void __fuzzy(node_pointer x, size_t depth, const sequence_type &s,
+                 size_t k, std::vector<size_t> &rows, sequence_type &path,
+                 F &visit) {
+        size_t m = s.size(), d = depth + 1;
+        // 本层使用的 k, 递归时仍然传入原来的 k
+        size_t kd = std::min(k, m + d);
+        if (rows.size() < (d + 1) * (m + 1)) rows.resize((d + 1) * (m + 1));
+        size_t from = d > kd ? d - kd : 1, to = std::min(m, d + kd);
+        for (auto it = x->children.begin(); it != x->children.end(); ++it) {
+            node_pointer y = it->second;
+            if (!y) continue;
+            TRIETREE_COUNT(hot_counters.child_lookups, 1);
+            // 递归时 rows 可能扩大, 每次重新取行的位置
+            const size_t *prev = &rows[depth * (m + 1)];
+            size_t *row = &rows[d * (m + 1)];
+            row[0] = std::min(d, kd + 1);
+            if (from > 1 && from - 1 <= m) row[from - 1] = kd + 1;
+            size_t lo = row[0];
+            for (size_t j = from; j <= to; j++) {
+                row[j] = std::min({prev[j] + 1, row[j - 1] + 1,
+                                   prev[j - 1] + (s[j - 1] != it->first)});
+                lo = std::min(lo, row[j]);
+            }
+            if (to < m) row[to + 1] = kd + 1;
+            if (lo > kd) continue;
+            path.push_back(it->first);
+            // 带外的 row[m] 没有计算, 距离一定超过 k
+            bool in_band = m == 0 || (from <= m && to == m);
+            if (y->isLeaf && y->count > 0 && in_band && row[m] <= kd)
+                visit(std::as_const(path), y->count, row[m]);
+            __fuzzy(y, depth + 1, s, k, rows, path, visit);
+            path.pop_back();
+        }
+    }
+
+    static void __prefetch(const void *p) {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(p);
+#else
+        (void)p;
+#endif
+    }
+
+    // 分组交替地沿着每个 key 下降, 每个 key 结束时调用 done(下标, 节点)
+    template <class F>
+    void __batch(std::span<const sequence_type> keys, F &&done) {
+        struct state_t {
+            node_pointer x;
+            size_t pos;
+        };
+        state_t st[BATCH_GROUP];
+        size_t active[BATCH_GROUP];
+        for (size_t base = 0; base < keys.size(); base += BATCH_GROUP) {
+            size_t n = std::min(BATCH_GROUP, keys.size() - base), m = n;
+            for (size_t j = 0; j < n; j++) {
+                st[j] = state_t{root, 0};
+                active[j] = j;
+            }
+            TRIETREE_COUNT(hot_counters.searches, n);
+            while (m > 0) {
+                // art_map 的孩子保存在单独分配的布局中, 先预取
+                if constexpr (Type == 3)
+                    for (size_t k = 0; k < m; k++)
+                        st[active[k]].x->children.prefetch();
+                size_t k = 0;
+                while (k < m) {
+                    size_t j = active[k];
+                    const sequence_type &key = keys[base + j];
+                    state_t &s = st[j];
+                    while (s.pos < key.size() && key[s.pos] == endMark)
+                        s.pos++;
+                    node_pointer y = nullptr;
+                    bool finished = s.pos == key.size();
+                    if (!finished) {
+                        TRIETREE_COUNT(hot_counters.child_lookups, 1);
+                        auto it = s.x->children.find(key[s.pos]);
+                        if (it != s.x->children.end() && it->second) {
+                            y = it->second;
+                            s.pos++;
+                        } else {
+                            finished = true;
+                        }
+                    }
+                    if (finished) {
+                        done(base + j, s.pos == key.size() ? s.x : nullptr);
+                        active[k] = active[--m];
+                        continue;
+                    }
+                    __prefetch(y);
+                    s.x = y;
+                    k++;
+                }
+            }
+        }
     }
 
+    // 是否有孩子节点, 孩子容器中不保存空指针, O(1)
+    bool hasChildren(node_pointer x) { return !x->children.empty(); }
+
    private:
+    // top-K 搜索的队列元素, 节点以 maxCount 为优先级, 单词以 count 为优先级
+    struct topk_item_t {
+        int priority;
+        bool word;
+        size_t index;
+        // 优先级相同时先弹出单词, 再按入队先后
+        bool operator<(const topk_item_t &other) const {
+            if (priority != other.priority) return priority < other.priority;
+            if (word != other.word) return word < other.word;
+            return index > other.index;
+        }
+    };
+
     node_pointer root;
-    std::vector<sequence_type> __vcLs;
+    allocator_type alloc;
+    mutable trie_counters hot_counters;
+};
+
+// ac自动机的匹配结果: 模式串编号, 在文本中的起始位置和长度
+struct ac_match_t {
+    int id;
+    size_t start;
+    size_t length;
+};
+
+// ac自动机的匹配语义
+enum class ac_match_kind {
+    // 报告所有匹配, 匹配之间可以重叠
+    overlapping,
+    // 从最左边的位置开始, 优先选择最先加入的模式串, 匹配之间不重叠
+    leftmost_first,
+    // 从最左边的位置开始, 优先选择最长的模式串, 匹配之间不重叠
+    leftmost_longest,
+};
+
+// ac自动机是否区分大小写, 只用于 AC_automaton<char>
+enum class ac_case {
+    // 区分大小写, 按字节匹配
+    sensitive,
+    // 不区分 ASCII 字母的大小写
+    ascii,
+    // UTF-8 文本, 按 Unicode 简单大小写折叠(只包括编码长度不变的折叠)
+    unicode,
 };
 
-template <class T = char, int Type = 1, T endMark = '\0'>
+// ac自动机的结构统计
+struct ac_stats {
+    // trie树部分的统计
+    trie_stats trie;
+    // 加入的模式串个数(包括重复的)
+    size_t patterns = 0;
+    // 从每个状态沿 fail 指针到根节点的跳数, 平均值和最大值
+    double avg_fail_depth = 0;
+    size_t max_fail_depth = 0;
+    // 每个状态的输出个数(自身和 fail 链上的模式串), 平均值和最大值
+    double avg_outputs = 0;
+    size_t max_outputs = 0;
+    // 编译后的DFA: 状态数, 字节类数和状态转移表等占用的字节数
+    size_t dfa_states = 0;
+    size_t dfa_classes = 0;
+    size_t dfa_bytes = 0;
+};
+
+template <class T = char, int Type = 1, T endMark = '\0',
+          template <class> class Alloc = heap_node_allocator>
 class AC_automaton {
    public:
     using node_type = TrieNodeData<T, Type>;
     using node_pointer = node_type *;
     using node_pointer_ref = node_pointer &;
 
-    using sequence_type = typename TrieTree<T, Type, endMark>::sequence_type;
+    using sequence_type =
+        typename TrieTree<T, Type, endMark, Alloc>::sequence_type;
     using const_reference_list_type = const sequence_type &;
     using reference_list_type = sequence_type &;
+    // 待匹配的文本, 不拷贝输入
+    using haystack_type =
+        typename std::conditional<isChar<T>::value, std::basic_string_view<T>,
+                                  std::span<const T>>::type;
 
     AC_automaton() { root = trie.get_root(); }
+    /**
+     * @note  不区分大小写时, 模式串在加入trie前折叠为小写, compile() 为每个
+     * 字符的其他大小写形式加入指向同一状态的转移(多字节字符加入中间状态),
+     * 匹配时不需要折叠输入. 不区分大小写的自动机在 buildAC_automaton 时
+     * 自动编译为DFA. 只支持 AC_automaton<char>(UTF-8 文本)
+     */
+    explicit AC_automaton(ac_case mode) : case_mode(mode) {
+        static_assert(std::is_same_v<T, char>,
+                      "ac_case is only supported for AC_automaton<char>");
+        root = trie.get_root();
+    }
     ~AC_automaton() {}
 
     // 构建Trie树
     void buildTrieTree(const std::vector<sequence_type> &vs) {
-        for (auto x : vs) trie.insert(x);
+        if constexpr (std::is_same_v<T, char>) {
+            if (case_mode != ac_case::sensitive) {
+                std::vector<sequence_type> folded;
+                for (auto &s : vs)
+                    folded.push_back(
+                        utf8::fold(s, case_mode == ac_case::ascii));
+                return __build_trie(folded);
+            }
+        }
+        __build_trie(vs);
     }
 
     // 构建ac自动机
@@ -374,6 +1023,9 @@ class AC_automaton {
             q.pop();
             // 当前节点x的子节点
             for (auto xc : x->children) {
+                // ac自动机中 length 为节点的深度, 即匹配的长度
+                xc.second->length = x->length + 1;
+                xc.second->fail = root;
                 node_pointer xf = x->fail;
                 // 沿着树向上，直到根节点的fail=nullptr
                 while (xf != nullptr) {
@@ -384,40 +1036,552 @@ class AC_automaton {
                     }
                     xf = xf->fail;
                 }
+                // fail 节点更浅, 它的 output 已经计算完毕
+                node_pointer f = xc.second->fail;
+                xc.second->output =
+                    f == root ? nullptr : (f->isLeaf ? f : f->output);
+                max_length = std::max(max_length, (size_t)xc.second->length);
                 q.push(xc.second);
             }
         }
+        if constexpr (sizeof(T) == 1)
+            if (case_mode != ac_case::sensitive) compile();
     }
 
-    void start_ac_automaton(const std::string &s) {
-        node_pointer x = root;
+    /**
+     * @brief 将ac自动机编译为稠密的DFA状态转移表(仅支持单字节字符)
+     * @note  需要在 buildAC_automaton 之后调用.
+     * 没有出现在模式串中的字节归为同一个字节类, 每个状态只保存 classes 个
+     * 转移, 所有 (状态, 字节) 都预先沿 fail 指针解析完毕, 匹配时每个字节
+     * 只需要一次查表
+     */
+    void compile() {
+        static_assert(sizeof(T) == 1, "compile() only supports char patterns");
+
+        // 按BFS顺序为每个节点编号, 记录父节点和边上的字节
+        std::vector<node_pointer> nodes{root};
+        dfa_graph_t g;
+        g.edges.emplace_back();
+        g.parents.emplace_back(0, 0);
+        for (uint32_t i = 0; i < nodes.size(); i++) {
+            node_pointer x = nodes[i];
+            for (auto it = x->children.begin(); it != x->children.end();
+                 ++it) {
+                uint32_t j = (uint32_t)nodes.size();
+                nodes.push_back(it->second);
+                g.edges[i].emplace_back((unsigned char)it->first, j);
+                g.edges.emplace_back();
+                g.parents.emplace_back(i, (unsigned char)it->first);
+            }
+        }
+        states.assign(nodes.size(), dfa_state_t{});
+        for (uint32_t i = 0; i < nodes.size(); i++)
+            states[i] = dfa_state_t{0, 0, nodes[i]->length, nodes[i]->id,
+                                    i != 0 && nodes[i]->isLeaf};
+        if (case_mode != ac_case::sensitive) __add_case_variants(nodes, g);
+
+        // 字节类压缩: 出现在转移中的字节各占一类, 其余字节为第0类
+        byte_class.fill(0);
+        classes = 1;
+        for (auto &e : g.edges)
+            for (auto [c, j] : e)
+                if (byte_class[c] == 0) byte_class[c] = classes++;
+
+        // 按深度依次处理, fail 状态总是更浅, 它的转移已经计算完毕:
+        // fail(s) = delta(fail(父状态), 边上的字节), 没有的转移沿用 fail 状态的
+        std::vector<uint32_t> order(states.size());
+        for (uint32_t i = 0; i < order.size(); i++) order[i] = i;
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            return states[a].length < states[b].length;
+        });
+        // 状态编号预先乘以 classes, 匹配时 s = delta[s + class],
+        // 最高位标记目标状态(或其 fail 链上)有输出
+        delta.assign(states.size() * classes, 0);
+        for (uint32_t i : order) {
+            if (i != 0) {
+                auto [p, c] = g.parents[i];
+                uint32_t f =
+                    p == 0 ? 0
+                           : delta[states[p].fail * classes + byte_class[c]] /
+                                 classes;
+                states[i].fail = f;
+                states[i].output = states[f].isLeaf ? f : states[f].output;
+                std::copy_n(delta.begin() + f * classes, classes,
+                            delta.begin() + i * classes);
+            }
+            for (auto [c, j] : g.edges[i])
+                delta[i * classes + byte_class[c]] = j * classes;
+        }
+        for (auto &d : delta) {
+            const dfa_state_t &st = states[d / classes];
+            if (st.isLeaf || st.output != 0) d |= output_flag;
+        }
+    }
+    bool compiled() const { return !delta.empty(); }
+
+    /**
+     * @brief 扫描文本, 每个匹配调用一次 visit(const ac_match_t &)
+     * @note  visit 返回 false 时立即停止扫描, 匹配过程中不分配内存
+     * @retval 扫描完整个文本时返回 true, 被 visit 提前终止时返回 false
+     */
+    template <class F>
+    bool match(haystack_type s, F &&visit,
+               ac_match_kind kind = ac_match_kind::overlapping) {
+        if constexpr (sizeof(T) == 1)
+            if (compiled()) return __match(s, dfa_cursor{this}, visit, kind);
+        return __match(s, node_cursor{root, &hot_counters}, visit, kind);
+    }
+
+    // 是否存在任意一个匹配, 找到后立即返回
+    bool is_match(haystack_type s) {
+        return !match(s, [](const ac_match_t &) { return false; });
+    }
+
+    // 第一个匹配
+    std::optional<ac_match_t> find_first(
+        haystack_type s, ac_match_kind kind = ac_match_kind::leftmost_first) {
+        std::optional<ac_match_t> r;
+        match(
+            s,
+            [&](const ac_match_t &m) {
+                r = m;
+                return false;
+            },
+            kind);
+        return r;
+    }
+
+    // 所有匹配
+    std::vector<ac_match_t> find_all(
+        haystack_type s, ac_match_kind kind = ac_match_kind::overlapping) {
+        std::vector<ac_match_t> r;
+        match(
+            s, [&](const ac_match_t &m) { r.push_back(m); }, kind);
+        return r;
+    }
+
+    /**
+     * @brief 多线程并行扫描, 只支持 overlapping 语义
+     * @note  输入被切分为若干分块, 由 threads 个线程依次领取并在同一个只读
+     * 自动机上扫描. 每个分块向前多扫描 (最长模式串长度-1) 个字符, 只保留
+     * 结束位置落在本分块内的匹配, 因此边界上的匹配恰好报告一次.
+     * 所有匹配按照与单线程扫描相同的顺序回调 visit
+     */
+    template <class F>
+    bool parallel_match(haystack_type s, F &&visit, unsigned threads = 0) {
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
 
-        for (int i = 0; i < s.size(); i++) {
-            char c = s.at(i);
+        const size_t n = s.size();
+        const size_t overlap = max_length > 0 ? max_length - 1 : 0;
+        // 每个线程分到若干个分块以均衡负载, 分块不小于 PARALLEL_MIN_CHUNK
+        size_t chunks = std::min<size_t>(threads * 4, n / PARALLEL_MIN_CHUNK);
+        if (threads == 1 || chunks <= 1) return match(s, visit);
+
+        std::vector<std::vector<ac_match_t>> results(chunks);
+        std::atomic<size_t> next{0};
+        auto worker = [&] {
+            for (size_t k; (k = next.fetch_add(1)) < chunks;) {
+                size_t b = n / chunks * k;
+                size_t e = k + 1 == chunks ? n : n / chunks * (k + 1);
+                size_t from = b > overlap ? b - overlap : 0;
+                auto &r = results[k];
+                match(haystack_type(s.data() + from, e - from),
+                      [&](const ac_match_t &m) {
+                          if (from + m.start + m.length > b)
+                              r.push_back(ac_match_t{m.id, from + m.start,
+                                                     m.length});
+                      });
+            }
+        };
+        std::vector<std::thread> pool;
+        for (unsigned i = 1; i < threads; i++) pool.emplace_back(worker);
+        worker();
+        for (auto &t : pool) t.join();
+
+        for (auto &r : results)
+            for (auto &m : r)
+                if (!__visit(visit, m)) return false;
+        return true;
+    }
+    std::vector<ac_match_t> parallel_find_all(haystack_type s,
+                                              unsigned threads = 0) {
+        std::vector<ac_match_t> r;
+        parallel_match(
+            s, [&](const ac_match_t &m) { r.push_back(m); }, threads);
+        return r;
+    }
+
+    // 最长模式串的长度
+    size_t max_pattern_length() const { return max_length; }
+    ac_case case_sensitivity() const { return case_mode; }
+
+    /**
+     * @brief 流式扫描器, 保存当前的自动机状态和全局偏移
+     * @note  依次调用 feed 传入连续的缓冲区, 跨越缓冲区边界的匹配也会以
+     * 全局偏移报告, 输入不会被拷贝或拼接. 只支持 overlapping 语义.
+     * 扫描过程中自动机不能被修改或重新编译
+     */
+    class scanner {
+       public:
+        explicit scanner(AC_automaton &ac) : ac(&ac) { reset(); }
+
+        // 扫描下一个缓冲区, visit 返回 false 时停止,
+        // 此时 offset() 为已经消费的字符数, 可以从该位置继续 feed
+        template <class F>
+        bool feed(haystack_type chunk, F &&visit) {
+            if constexpr (sizeof(T) == 1)
+                if (ac->compiled())
+                    return __scan(chunk, dfa_cursor{ac}, state, pos, visit);
+            return __scan(chunk, node_cursor{ac->root, &ac->hot_counters},
+                          node, pos, visit);
+        }
+        void reset() {
+            node = ac->root;
+            state = 0;
+            pos = 0;
+        }
+        size_t offset() const { return pos; }
+
+       private:
+        AC_automaton *ac;
+        node_pointer node;
+        uint32_t state;
+        size_t pos;
+    };
+    scanner make_scanner() { return scanner(*this); }
 
-            while (x != root && x->children.find(c) == x->children.end()) {
+    // 编号为 id 的模式串在trie中的节点
+    node_pointer pattern(int id) { return patterns[id]; }
+    // 加入的模式串个数(包括重复的)
+    size_t pattern_count() const { return patterns.size(); }
+    node_pointer get_root() { return root; }
+
+    /**
+     * @brief 结构统计, 包括 fail 链长度和每个状态的输出个数
+     * @note  fail 节点总是比当前节点浅, 按BFS顺序由 fail 节点的结果递推.
+     * 输出个数多的状态说明有大量互为后缀的模式串, 每次到达都要报告所有匹配
+     */
+    ac_stats stats() const {
+        ac_stats st;
+        st.trie = trie.stats();
+        st.patterns = patterns.size();
+        // 节点 -> (fail 链长度, 输出个数)
+        std::unordered_map<node_pointer, std::pair<size_t, size_t>> info{
+            {root, {0, 0}}};
+        std::queue<node_pointer> q;
+        q.push(root);
+        size_t fail_sum = 0, output_sum = 0;
+        while (!q.empty()) {
+            node_pointer x = q.front();
+            q.pop();
+            for (auto it = x->children.begin(); it != x->children.end();
+                 ++it) {
+                node_pointer y = it->second;
+                auto f = info.find(y->fail ? y->fail : root);
+                size_t depth = f->second.first + 1;
+                size_t outputs = f->second.second + (y->isLeaf ? 1 : 0);
+                info[y] = {depth, outputs};
+                fail_sum += depth;
+                output_sum += outputs;
+                st.max_fail_depth = std::max(st.max_fail_depth, depth);
+                st.max_outputs = std::max(st.max_outputs, outputs);
+                q.push(y);
+            }
+        }
+        st.avg_fail_depth = (double)fail_sum / st.trie.nodes;
+        st.avg_outputs = (double)output_sum / st.trie.nodes;
+        if (compiled()) {
+            st.dfa_states = states.size();
+            st.dfa_classes = classes;
+            st.dfa_bytes = delta.size() * sizeof(uint32_t) +
+                           states.size() * sizeof(dfa_state_t) +
+                           sizeof(byte_class);
+        }
+        return st;
+    }
+
+    // 热路径计数器, 定义了 TRIETREE_STATS 时才计数
+    const trie_counters &counters() const { return hot_counters; }
+    void reset_counters() { hot_counters.reset(); }
+
+    // 状态 x 的输出列表: 自身以及 fail 链上所有完整的模式串节点, 由长到短
+    class output_range {
+       public:
+        class iterator {
+           public:
+            explicit iterator(node_pointer x) : x(x) {}
+            node_pointer operator*() const { return x; }
+            iterator &operator++() {
+                x = x->output;
+                return *this;
+            }
+            bool operator!=(const iterator &it) const { return x != it.x; }
+            bool operator==(const iterator &it) const { return x == it.x; }
+
+           private:
+            node_pointer x;
+        };
+
+        output_range(node_pointer x, node_pointer root)
+            : first(x == root ? nullptr : (x->isLeaf ? x : x->output)) {}
+        iterator begin() const { return iterator(first); }
+        iterator end() const { return iterator(nullptr); }
+        bool empty() const { return first == nullptr; }
+
+       private:
+        node_pointer first;
+    };
+    output_range outputs(node_pointer x) { return output_range(x, root); }
+
+    void start_ac_automaton(haystack_type s) {
+        match(s, [&](const ac_match_t &m) {
+            std::cout << s.substr(m.start, m.length) << "\tindex: " << m.start
+                      << "\tlength : " << m.length
+                      << "\tcount : " << patterns[m.id]->count << '\n';
+        });
+    }
+
+   private:
+    // 编译后每个状态的输出信息
+    struct dfa_state_t {
+        uint32_t fail;
+        // fail 链上最近的输出状态, 0 表示没有
+        uint32_t output;
+        int length;
+        int id;
+        bool isLeaf;
+    };
+    static constexpr uint32_t output_flag = 0x80000000u;
+    static constexpr uint32_t state_mask = ~output_flag;
+
+    // 基于trie节点和 fail 指针的状态转移
+    struct node_cursor {
+        node_pointer root;
+        trie_counters *counters;
+
+        node_pointer start() const { return root; }
+        node_pointer next(node_pointer x, T c) const {
+            while (true) {
+                if (auto y = x->children.find(c); y != x->children.end())
+                    return y->second;
+                if (x == root) return x;
                 x = x->fail;
+                TRIETREE_COUNT(counters->fail_hops, 1);
             }
-            if (auto y = x->children.find(c); y != x->children.end())
-                x = y->second;
-
-            node_pointer z = x;
-
-            while (z != root) {
-                // 只有在叶子节点才是一个完整的单词/序列
-                if (z->isLeaf) {
-                    int pos = i + 1 - z->length;
-                    std::cout << s.substr(pos, z->length) << "\tindex: " << pos
-                              << "\tlength : " << z->length
-                              << "\tcount : " << z->count << std::endl;
+        }
+        trie_counters &stat() const { return *counters; }
+        int depth(node_pointer x) const { return x->length; }
+        template <class G>
+        bool outputs(node_pointer x, G &&g) const {
+            // 沿 output 指针只访问完整的模式串
+            for (auto z : output_range(x, root))
+                if (!g(z->id, z->length)) return false;
+            return true;
+        }
+    };
+
+    // 基于稠密状态转移表的状态转移
+    struct dfa_cursor {
+        const AC_automaton *ac;
+
+        uint32_t start() const { return 0; }
+        trie_counters &stat() const { return ac->hot_counters; }
+        uint32_t next(uint32_t x, T c) const {
+            return ac->delta[(x & state_mask) +
+                             ac->byte_class[(unsigned char)c]];
+        }
+        int depth(uint32_t x) const {
+            return ac->states[(x & state_mask) / ac->classes].length;
+        }
+        template <class G>
+        bool outputs(uint32_t x, G &&g) const {
+            if (!(x & output_flag)) return true;
+            uint32_t z = (x & state_mask) / ac->classes;
+            if (!ac->states[z].isLeaf) z = ac->states[z].output;
+            for (; z != 0; z = ac->states[z].output) {
+                const dfa_state_t &st = ac->states[z];
+                if (!g(st.id, st.length)) return false;
+            }
+            return true;
+        }
+    };
+
+    // 编译DFA时的状态图: 每个状态的转移, 以及 (父状态, 边上的字节)
+    struct dfa_graph_t {
+        std::vector<std::vector<std::pair<unsigned char, uint32_t>>> edges;
+        std::vector<std::pair<uint32_t, unsigned char>> parents;
+    };
+
+    /**
+     * @brief 为trie中每个字符的其他大小写形式加入转移
+     * @note  从字符开始的节点出发, 沿其他形式的字节到达该字符结束的节点;
+     * 多字节字符的前缀与已有的转移不同时加入中间状态. 折叠不改变编码长度,
+     * 因此到达的节点深度与匹配的长度不变
+     */
+    void __add_case_variants(const std::vector<node_pointer> &nodes,
+                             dfa_graph_t &g) {
+        std::unordered_map<node_pointer, uint32_t> ids;
+        for (uint32_t i = 0; i < nodes.size(); i++) ids[nodes[i]] = i;
+        auto go = [&](uint32_t s, unsigned char c) -> int64_t {
+            for (auto [b, j] : g.edges[s])
+                if (b == c) return j;
+            return -1;
+        };
+        for (uint32_t i = 0; i < nodes.size(); i++) {
+            // 从节点 i 开始的每个完整字符: (编码, 结束节点, 编码长度)
+            std::vector<std::tuple<std::string, node_pointer, int>> stack, chars;
+            node_pointer x = nodes[i];
+            for (auto it = x->children.begin(); it != x->children.end(); ++it)
+                if (int n = utf8::sequence_length((unsigned char)it->first))
+                    stack.emplace_back(std::string(1, it->first), it->second, n);
+            while (!stack.empty()) {
+                auto [bytes, y, n] = stack.back();
+                stack.pop_back();
+                if ((int)bytes.size() == n) {
+                    chars.emplace_back(bytes, y, n);
+                    continue;
+                }
+                for (auto it = y->children.begin(); it != y->children.end();
+                     ++it)
+                    stack.emplace_back(bytes + it->first, it->second, n);
+            }
+            for (auto &[bytes, y, n] : chars) {
+                size_t pos = 0;
+                uint32_t cp = utf8::decode(bytes, pos);
+                if (cp == utf8::INVALID) continue;
+                std::vector<uint32_t> variants;
+                if (case_mode == ac_case::unicode)
+                    variants = utf8::case_variants(cp);
+                else if (cp >= 'a' && cp <= 'z')
+                    variants.push_back(cp - 0x20);
+                for (uint32_t v : variants) {
+                    std::string vb;
+                    utf8::encode(v, vb);
+                    uint32_t cur = i;
+                    for (int k = 0; k + 1 < n; k++) {
+                        unsigned char c = (unsigned char)vb[k];
+                        int64_t next = go(cur, c);
+                        if (next < 0) {
+                            // 多字节字符的中间状态, 没有输出
+                            next = (uint32_t)states.size();
+                            states.push_back(dfa_state_t{
+                                0, 0, states[cur].length + 1, -1, false});
+                            g.edges.emplace_back();
+                            g.parents.emplace_back(cur, c);
+                            g.edges[cur].emplace_back(c, (uint32_t)next);
+                        }
+                        cur = (uint32_t)next;
+                    }
+                    unsigned char last = (unsigned char)vb[n - 1];
+                    if (go(cur, last) < 0)
+                        g.edges[cur].emplace_back(last, ids[y]);
                 }
-                // 跳转到另外的分支输出匹配的字符串
-                z = z->fail;
             }
         }
     }
 
+    void __build_trie(const std::vector<sequence_type> &vs) {
+        // 有序的模式串可以沿用公共前缀批量构建
+        trie.insert_sorted(vs.begin(), vs.end(), [&](node_pointer y) {
+            // 模式串编号为其第一次加入的位置, 重复的模式串共用一个编号
+            if (y->id < 0) y->id = (int)patterns.size();
+            patterns.push_back(y);
+        });
+        // 新的模式串会使已编译的状态转移表失效
+        delta.clear();
+    }
+
+    template <class F>
+    static bool __visit(F &visit, const ac_match_t &m) {
+        if constexpr (std::is_same_v<
+                          std::invoke_result_t<F &, const ac_match_t &>, bool>)
+            return visit(m);
+        else {
+            visit(m);
+            return true;
+        }
+    }
+
+    // 从状态 x 开始扫描 s, offset 为 s 第一个字符在整个输入中的位置,
+    // 返回时 x 和 offset 更新为扫描结束(或被 visit 终止)时的位置
+    template <class Cursor, class State, class F>
+    static bool __scan(haystack_type s, Cursor cur, State &x, size_t &offset,
+                       F &visit) {
+        for (size_t i = 0; i < s.size(); i++) {
+            x = cur.next(x, s[i]);
+            TRIETREE_COUNT(cur.stat().transitions, 1);
+            size_t end = offset + i + 1;
+            bool ok = cur.outputs(x, [&](int id, int length) {
+                TRIETREE_COUNT(cur.stat().matches, 1);
+                return __visit(visit,
+                               ac_match_t{id, end - length, (size_t)length});
+            });
+            if (!ok) {
+                offset = end;
+                return false;
+            }
+        }
+        offset += s.size();
+        return true;
+    }
+
+    template <class Cursor, class F>
+    static bool __match(haystack_type s, Cursor cur, F &visit,
+                        ac_match_kind kind) {
+        const size_t n = s.size();
+        if (kind == ac_match_kind::overlapping) {
+            auto x = cur.start();
+            size_t offset = 0;
+            return __scan(s, cur, x, offset, visit);
+        }
+
+        // leftmost: 记录起始位置最小的候选匹配, 当前状态的深度说明之后
+        // 不可能再出现起始位置不大于候选的匹配时, 输出候选并从其末尾重新开始
+        size_t i = 0;
+        while (i < n) {
+            auto x = cur.start();
+            bool found = false;
+            ac_match_t best{};
+            for (size_t j = i; j < n; j++) {
+                x = cur.next(x, s[j]);
+                TRIETREE_COUNT(cur.stat().transitions, 1);
+                cur.outputs(x, [&](int id, int length) {
+                    size_t start = j + 1 - length;
+                    if (!found || start < best.start ||
+                        (start == best.start &&
+                         (kind == ac_match_kind::leftmost_longest
+                              ? (size_t)length > best.length
+                              : id < best.id))) {
+                        best = ac_match_t{id, start, (size_t)length};
+                        found = true;
+                    }
+                    return true;
+                });
+                if (found && j + 1 - cur.depth(x) > best.start) break;
+            }
+            if (!found) return true;
+            TRIETREE_COUNT(cur.stat().matches, 1);
+            if (!__visit(visit, best)) return false;
+            i = best.start + best.length;
+        }
+        return true;
+    }
+
    private:
-    TrieTree<T, Type, endMark> trie;
+    TrieTree<T, Type, endMark, Alloc> trie;
     node_pointer root;
+    // 模式串编号 -> trie中的节点
+    std::vector<node_pointer> patterns;
+
+    // 稠密DFA: 字节 -> 字节类, 以及 状态 x 字节类 的转移表
+    std::array<uint16_t, 256> byte_class;
+    uint16_t classes = 1;
+    std::vector<uint32_t> delta;
+    std::vector<dfa_state_t> states;
+
+    size_t max_length = 0;
+    static constexpr size_t PARALLEL_MIN_CHUNK = 1 << 16;
+    mutable trie_counters hot_counters;
+    ac_case case_mode = ac_case::sensitive;
 };
\ No newline at end of file
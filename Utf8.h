@@ -0,0 +1,193 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * UTF-8 编解码和 Unicode 简单大小写折叠(simple case folding)
+ * 折叠规则覆盖按固定偏移或奇偶成对的大小写: 拉丁(含扩展 A/B 的常用部分
+ * 和扩展附加), 希腊, 西里尔, 亚美尼亚, 格鲁吉亚, 格拉哥里, 带圈字母,
+ * 罗马数字, 全角拉丁字母和 Deseret. 只保留折叠前后 UTF-8 编码长度相同的
+ * 映射(例如不折叠 U+017F ſ -> s, U+212A 开尔文符号 -> k), 按字节匹配时
+ * 匹配的长度与原文相同
+ * */
+namespace utf8 {
+
+// 非法的 UTF-8 字节
+constexpr uint32_t INVALID = 0xFFFFFFFFu;
+
+// 首字节决定的编码长度, 不能作为首字节时返回 0
+inline int sequence_length(unsigned char lead) {
+    if (lead < 0x80) return 1;
+    if (lead < 0xC2) return 0;
+    if (lead < 0xE0) return 2;
+    if (lead < 0xF0) return 3;
+    if (lead < 0xF5) return 4;
+    return 0;
+}
+
+// 解码 s[i] 开始的一个字符, i 前进到下一个字符;
+// 非法时返回 INVALID 并前进一个字节
+inline uint32_t decode(std::string_view s, size_t &i) {
+    unsigned char lead = (unsigned char)s[i];
+    int n = sequence_length(lead);
+    if (n == 0 || i + n > s.size()) {
+        i++;
+        return INVALID;
+    }
+    if (n == 1) {
+        i++;
+        return lead;
+    }
+    uint32_t cp = lead & (0x7F >> n);
+    for (int k = 1; k < n; k++) {
+        unsigned char c = (unsigned char)s[i + k];
+        if ((c & 0xC0) != 0x80) {
+            i++;
+            return INVALID;
+        }
+        cp = cp << 6 | (c & 0x3F);
+    }
+    // 过长的编码和代理项
+    static constexpr uint32_t min_cp[5] = {0, 0, 0x80, 0x800, 0x10000};
+    if (cp < min_cp[n] || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+        i++;
+        return INVALID;
+    }
+    i += n;
+    return cp;
+}
+
+inline int encoded_length(uint32_t cp) {
+    return cp < 0x80 ? 1 : cp < 0x800 ? 2 : cp < 0x10000 ? 3 : 4;
+}
+
+inline void encode(uint32_t cp, std::string &out) {
+    if (cp < 0x80) {
+        out.push_back((char)cp);
+    } else if (cp < 0x800) {
+        out.push_back((char)(0xC0 | cp >> 6));
+        out.push_back((char)(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        out.push_back((char)(0xE0 | cp >> 12));
+        out.push_back((char)(0x80 | (cp >> 6 & 0x3F)));
+        out.push_back((char)(0x80 | (cp & 0x3F)));
+    } else {
+        out.push_back((char)(0xF0 | cp >> 18));
+        out.push_back((char)(0x80 | (cp >> 12 & 0x3F)));
+        out.push_back((char)(0x80 | (cp >> 6 & 0x3F)));
+        out.push_back((char)(0x80 | (cp & 0x3F)));
+    }
+}
+
+// 由宽字符串编码, wchar_t 为 2 字节时按 UTF-16 处理代理对
+inline std::string encode(std::wstring_view ws) {
+    std::string out;
+    for (size_t i = 0; i < ws.size(); i++) {
+        uint32_t cp = (uint32_t)ws[i];
+        if constexpr (sizeof(wchar_t) == 2) {
+            if (cp >= 0xD800 && cp <= 0xDBFF && i + 1 < ws.size() &&
+                ws[i + 1] >= 0xDC00 && ws[i + 1] <= 0xDFFF)
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (ws[++i] - 0xDC00);
+        }
+        if (cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) cp = 0xFFFD;
+        encode(cp, out);
+    }
+    return out;
+}
+
+// 单个字符的简单大小写折叠(折叠为小写), 没有折叠或长度会改变时返回 cp
+inline uint32_t simple_fold(uint32_t cp) {
+    // [first, last] 内的字符加上 delta
+    struct shift_t {
+        uint32_t first, last;
+        int32_t delta;
+    };
+    // [first, last] 内与 first 奇偶相同的字符折叠为下一个字符
+    struct pair_t {
+        uint32_t first, last;
+    };
+    static constexpr shift_t shifts[] = {
+        {0x41, 0x5A, 0x20},       {0xB5, 0xB5, 0x307},
+        {0xC0, 0xD6, 0x20},       {0xD8, 0xDE, 0x20},
+        {0x178, 0x178, -0x79},    {0x1C4, 0x1C4, 2},
+        {0x1C5, 0x1C5, 1},        {0x1C7, 0x1C7, 2},
+        {0x1C8, 0x1C8, 1},        {0x1CA, 0x1CA, 2},
+        {0x1CB, 0x1CB, 1},        {0x1F1, 0x1F1, 2},
+        {0x1F2, 0x1F2, 1},        {0x386, 0x386, 0x26},
+        {0x388, 0x38A, 0x25},     {0x38C, 0x38C, 0x40},
+        {0x38E, 0x38F, 0x3F},     {0x391, 0x3A1, 0x20},
+        {0x3A3, 0x3AB, 0x20},     {0x3C2, 0x3C2, 1},
+        {0x400, 0x40F, 0x50},     {0x410, 0x42F, 0x20},
+        {0x4C0, 0x4C0, 0xF},      {0x531, 0x556, 0x30},
+        {0x10A0, 0x10C5, 0x1C60}, {0x10C7, 0x10C7, 0x1C60},
+        {0x10CD, 0x10CD, 0x1C60}, {0x2132, 0x2132, 0x1C},
+        {0x2160, 0x216F, 0x10},   {0x24B6, 0x24CF, 0x1A},
+        {0x2C00, 0x2C2F, 0x30},   {0xFF21, 0xFF3A, 0x20},
+        {0x10400, 0x10427, 0x28},
+    };
+    static constexpr pair_t pairs[] = {
+        {0x100, 0x12F},   {0x132, 0x137},   {0x139, 0x148},
+        {0x14A, 0x177},   {0x179, 0x17E},   {0x1CD, 0x1DC},
+        {0x1DE, 0x1EF},   {0x1F8, 0x21F},   {0x222, 0x233},
+        {0x3D8, 0x3EF},   {0x460, 0x481},   {0x48A, 0x4BF},
+        {0x4C1, 0x4CE},   {0x4D0, 0x52F},   {0x1E00, 0x1E95},
+        {0x1EA0, 0x1EFF}, {0x2183, 0x2183}, {0xA640, 0xA66D},
+        {0xA680, 0xA69B}, {0xA722, 0xA72F}, {0xA732, 0xA76F},
+        {0xA779, 0xA77C}, {0xA77E, 0xA787}, {0xA78B, 0xA78B},
+    };
+    if (cp < 0x41) return cp;
+    uint32_t folded = cp;
+    for (auto &s : shifts)
+        if (cp >= s.first && cp <= s.last) {
+            folded = (uint32_t)((int32_t)cp + s.delta);
+            break;
+        }
+    if (folded == cp)
+        for (auto &p : pairs)
+            if (cp >= p.first && cp <= p.last) {
+                if ((cp - p.first) % 2 == 0) folded = cp + 1;
+                break;
+            }
+    return encoded_length(folded) == encoded_length(cp) ? folded : cp;
+}
+
+// 逐个字符折叠, ascii_only 时只折叠 ASCII 字母, 非法的字节原样保留
+inline std::string fold(std::string_view s, bool ascii_only = false) {
+    std::string out;
+    out.reserve(s.size());
+    for (size_t i = 0; i < s.size();) {
+        size_t from = i;
+        uint32_t cp = decode(s, i);
+        if (cp == INVALID || (ascii_only && cp >= 0x80))
+            out.append(s.substr(from, i - from));
+        else
+            encode(ascii_only ? (cp >= 'A' && cp <= 'Z' ? cp + 0x20 : cp)
+                              : simple_fold(cp),
+                   out);
+    }
+    return out;
+}
+
+// 折叠为 folded 的其他字符(不包括 folded 自身), 编码长度都与 folded 相同
+inline const std::vector<uint32_t> &case_variants(uint32_t folded) {
+    static const auto table = [] {
+        std::unordered_map<uint32_t, std::vector<uint32_t>> t;
+        // 所有折叠规则都在 U+10500 之前
+        for (uint32_t cp = 0; cp < 0x10500; cp++) {
+            if (cp >= 0xD800 && cp <= 0xDFFF) continue;
+            uint32_t f = simple_fold(cp);
+            if (f != cp) t[f].push_back(cp);
+        }
+        return t;
+    }();
+    static const std::vector<uint32_t> none;
+    auto it = table.find(folded);
+    return it == table.end() ? none : it->second;
+}
+
+}  // namespace utf8
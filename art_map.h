@@ -0,0 +1,419 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define ART_MAP_SSE2 1
+#endif
+
+/*
+ * 自适应基数树(ART)风格的孩子容器, key 为单字节
+ * 根据孩子个数在四种布局之间切换:
+ *   node4  : 最多 4 个, 有序的 key 数组线性查找
+ *   node16 : 最多 16 个, 有序的 key 数组, 用 SSE2 一次比较 16 个 key
+ *   node48 : 最多 48 个, 256 项的下标数组指向紧凑的槽位
+ *   node256: 以 key 直接为下标
+ * 没有孩子时不分配内存, 容器本身只有 16 字节.
+ * 元素以 std::pair<K, V> 保存, 迭代器按 key 从小到大遍历;
+ * 插入/删除可能改变布局, 使所有的迭代器和引用失效
+ * */
+template <class K, class V>
+class art_map {
+    static_assert(sizeof(K) == 1, "art_map only supports single byte keys");
+
+   public:
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = std::pair<K, V>;
+
+    art_map() {}
+    art_map(const art_map &other) {
+        for (auto it = other.begin(); it != other.end(); ++it)
+            try_emplace(it->first, it->second);
+    }
+    art_map(art_map &&other) noexcept { swap(other); }
+    art_map &operator=(art_map other) noexcept {
+        swap(other);
+        return *this;
+    }
+    ~art_map() { clear(); }
+
+    void swap(art_map &other) noexcept {
+        std::swap(kind, other.kind);
+        std::swap(count, other.count);
+        std::swap(data, other.data);
+    }
+
+    class iterator {
+       public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::pair<K, V>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = value_type *;
+        using reference = value_type &;
+
+        iterator() {}
+        iterator(const art_map *m, int pos) : m(m), pos(pos) {}
+
+        reference operator*() const { return *m->__slot(pos); }
+        pointer operator->() const { return m->__slot(pos); }
+        iterator &operator++() {
+            pos = m->__next(pos + 1);
+            return *this;
+        }
+        iterator operator++(int) {
+            iterator old(*this);
+            ++*this;
+            return old;
+        }
+        bool operator==(const iterator &it) const { return pos == it.pos; }
+        bool operator!=(const iterator &it) const { return pos != it.pos; }
+
+       private:
+        const art_map *m = nullptr;
+        int pos = END;
+    };
+    using const_iterator = iterator;
+
+    iterator begin() const { return iterator(this, __next(0)); }
+    iterator end() const { return iterator(this, END); }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    iterator find(K key) const {
+        uint8_t r = rank(key);
+        switch (kind) {
+            case KIND4: {
+                const node4 *n = (const node4 *)data;
+                for (int i = 0; i < count; i++)
+                    if (n->keys[i] == r) return iterator(this, i);
+                break;
+            }
+            case KIND16: {
+                int i = __find16((const node16 *)data, r);
+                if (i >= 0) return iterator(this, i);
+                break;
+            }
+            case KIND48:
+                if (((const node48 *)data)->index[r])
+                    return iterator(this, r);
+                break;
+            case KIND256:
+                if (__present((const node256 *)data, r))
+                    return iterator(this, r);
+                break;
+        }
+        return end();
+    }
+    size_t count_key(K key) const { return find(key) != end(); }
+
+    // key 不存在时插入 (key, value), 返回元素的迭代器和是否插入
+    std::pair<iterator, bool> try_emplace(K key, const V &value = V()) {
+        iterator it = find(key);
+        if (it != end()) return {it, false};
+        __grow();
+        uint8_t r = rank(key);
+        int pos;
+        switch (kind) {
+            case KIND4:
+                pos = __insert_sorted((node4 *)data, r, key, value);
+                break;
+            case KIND16:
+                pos = __insert_sorted((node16 *)data, r, key, value);
+                break;
+            case KIND48: {
+                node48 *n = (node48 *)data;
+                new (&n->slots()[count]) value_type(key, value);
+                n->index[r] = (uint8_t)(count + 1);
+                pos = r;
+                break;
+            }
+            default: {
+                node256 *n = (node256 *)data;
+                new (&n->slots()[r]) value_type(key, value);
+                n->present[r / 64] |= 1ull << (r % 64);
+                pos = r;
+                break;
+            }
+        }
+        count++;
+        return {iterator(this, pos), true};
+    }
+    std::pair<iterator, bool> emplace(K key, const V &value) {
+        return try_emplace(key, value);
+    }
+    std::pair<iterator, bool> insert(const value_type &v) {
+        return try_emplace(v.first, v.second);
+    }
+
+    V &operator[](K key) { return try_emplace(key).first->second; }
+
+    size_t erase(K key) {
+        uint8_t r = rank(key);
+        switch (kind) {
+            case KIND4:
+                if (!__erase_sorted((node4 *)data, r)) return 0;
+                break;
+            case KIND16:
+                if (!__erase_sorted((node16 *)data, r)) return 0;
+                break;
+            case KIND48: {
+                node48 *n = (node48 *)data;
+                int i = n->index[r] - 1;
+                if (i < 0) return 0;
+                value_type *s = n->slots();
+                s[i].~value_type();
+                // 最后一个槽位移到空出的位置
+                int last = count - 1;
+                if (i != last) {
+                    new (&s[i]) value_type(std::move(s[last]));
+                    s[last].~value_type();
+                    n->index[rank(s[i].first)] = (uint8_t)(i + 1);
+                }
+                n->index[r] = 0;
+                break;
+            }
+            case KIND256: {
+                node256 *n = (node256 *)data;
+                if (!__present(n, r)) return 0;
+                n->slots()[r].~value_type();
+                n->present[r / 64] &= ~(1ull << (r % 64));
+                break;
+            }
+            default:
+                return 0;
+        }
+        count--;
+        __shrink();
+        return 1;
+    }
+
+    void clear() {
+        for (auto it = begin(); it != end(); ++it) it->~value_type();
+        switch (kind) {
+            case KIND4: delete (node4 *)data; break;
+            case KIND16: delete (node16 *)data; break;
+            case KIND48: delete (node48 *)data; break;
+            case KIND256: delete (node256 *)data; break;
+        }
+        kind = KIND0;
+        count = 0;
+        data = nullptr;
+    }
+
+    // 孩子布局占用的堆内存字节数
+    size_t memory_bytes() const {
+        switch (kind) {
+            case KIND4: return sizeof(node4);
+            case KIND16: return sizeof(node16);
+            case KIND48: return sizeof(node48);
+            case KIND256: return sizeof(node256);
+        }
+        return 0;
+    }
+
+    // 预取保存孩子的内存块, 批量查找时在真正访问之前调用
+    void prefetch() const {
+#if defined(__GNUC__) || defined(__clang__)
+        if (data) __builtin_prefetch(data);
+#endif
+    }
+
+   private:
+    enum : uint8_t { KIND0, KIND4, KIND16, KIND48, KIND256 };
+    static constexpr int END = 256;
+
+    // 槽位只在插入时构造, 布局本身不构造任何元素
+    template <int N>
+    struct small_node {
+        uint8_t keys[N];
+        alignas(value_type) unsigned char storage[N * sizeof(value_type)];
+        value_type *slots() { return (value_type *)storage; }
+    };
+    using node4 = small_node<4>;
+    using node16 = small_node<16>;
+    struct node48 {
+        // 0 表示不存在, 否则为槽位下标+1
+        uint8_t index[256] = {};
+        alignas(value_type) unsigned char storage[48 * sizeof(value_type)];
+        value_type *slots() { return (value_type *)storage; }
+    };
+    struct node256 {
+        uint64_t present[4] = {};
+        alignas(value_type) unsigned char storage[256 * sizeof(value_type)];
+        value_type *slots() { return (value_type *)storage; }
+    };
+
+    // 有符号的 char 按其大小映射到 0..255, 使遍历顺序与 K 的顺序一致
+    static uint8_t rank(K key) {
+        if constexpr (std::is_signed<K>::value)
+            return (uint8_t)((uint8_t)key ^ 0x80);
+        else
+            return (uint8_t)key;
+    }
+
+    static bool __present(const node256 *n, int r) {
+        return n->present[r / 64] >> (r % 64) & 1;
+    }
+
+    int __find16(const node16 *n, uint8_t r) const {
+#ifdef ART_MAP_SSE2
+        __m128i keys = _mm_loadu_si128((const __m128i *)n->keys);
+        __m128i cmp = _mm_cmpeq_epi8(keys, _mm_set1_epi8((char)r));
+        // 只保留前 count 个 key 的比较结果
+        unsigned mask = (unsigned)_mm_movemask_epi8(cmp) & ((1u << count) - 1);
+        return mask ? std::countr_zero(mask) : -1;
+#else
+        for (int i = 0; i < count; i++)
+            if (n->keys[i] == r) return i;
+        return -1;
+#endif
+    }
+
+    // pos 处的元素: node4/node16 为槽位下标, node48/node256 为 key 的 rank
+    value_type *__slot(int pos) const {
+        switch (kind) {
+            case KIND4: return ((node4 *)data)->slots() + pos;
+            case KIND16: return ((node16 *)data)->slots() + pos;
+            case KIND48: {
+                node48 *n = (node48 *)data;
+                return n->slots() + n->index[pos] - 1;
+            }
+            default: return ((node256 *)data)->slots() + pos;
+        }
+    }
+    // 从 pos 开始的第一个元素的位置, 没有时为 END
+    int __next(int pos) const {
+        switch (kind) {
+            case KIND4:
+            case KIND16: return pos < count ? pos : END;
+            case KIND48: {
+                const node48 *n = (const node48 *)data;
+                for (; pos < 256; pos++)
+                    if (n->index[pos]) return pos;
+                return END;
+            }
+            case KIND256: {
+                const node256 *n = (const node256 *)data;
+                while (pos < 256) {
+                    uint64_t w = n->present[pos / 64] >> (pos % 64);
+                    if (w) return pos + std::countr_zero(w);
+                    pos = (pos / 64 + 1) * 64;
+                }
+                return END;
+            }
+            default: return END;
+        }
+    }
+
+    template <int N>
+    int __insert_sorted(small_node<N> *n, uint8_t r, K key, const V &value) {
+        int i = count;
+        value_type *s = n->slots();
+        for (; i > 0 && n->keys[i - 1] > r; i--) {
+            n->keys[i] = n->keys[i - 1];
+            new (&s[i]) value_type(std::move(s[i - 1]));
+            s[i - 1].~value_type();
+        }
+        n->keys[i] = r;
+        new (&s[i]) value_type(key, value);
+        return i;
+    }
+    template <int N>
+    bool __erase_sorted(small_node<N> *n, uint8_t r) {
+        int i = 0;
+        while (i < count && n->keys[i] != r) i++;
+        if (i == count) return false;
+        value_type *s = n->slots();
+        s[i].~value_type();
+        for (; i + 1 < count; i++) {
+            n->keys[i] = n->keys[i + 1];
+            new (&s[i]) value_type(std::move(s[i + 1]));
+            s[i + 1].~value_type();
+        }
+        return true;
+    }
+
+    // 满了之后换成更大的布局
+    void __grow() {
+        switch (kind) {
+            case KIND0:
+                data = new node4();
+                kind = KIND4;
+                break;
+            case KIND4:
+                if (count == 4) __rebuild(KIND16);
+                break;
+            case KIND16:
+                if (count == 16) __rebuild(KIND48);
+                break;
+            case KIND48:
+                if (count == 48) __rebuild(KIND256);
+                break;
+        }
+    }
+    // 元素较少时换成更小的布局, 留出余量避免在边界上反复切换
+    void __shrink() {
+        if (count == 0)
+            clear();
+        else if (kind == KIND16 && count <= 3)
+            __rebuild(KIND4);
+        else if (kind == KIND48 && count <= 12)
+            __rebuild(KIND16);
+        else if (kind == KIND256 && count <= 40)
+            __rebuild(KIND48);
+    }
+    void __rebuild(uint8_t to) {
+        art_map m;
+        m.kind = to;
+        switch (to) {
+            case KIND4: m.data = new node4(); break;
+            case KIND16: m.data = new node16(); break;
+            case KIND48: m.data = new node48(); break;
+            case KIND256: m.data = new node256(); break;
+        }
+        for (auto it = begin(); it != end(); ++it)
+            m.__append(std::move(*it));
+        swap(m);
+    }
+    // 按 key 从小到大追加, 布局的容量足够
+    void __append(value_type &&v) {
+        uint8_t r = rank(v.first);
+        switch (kind) {
+            case KIND4:
+            case KIND16: {
+                uint8_t *keys = kind == KIND4 ? ((node4 *)data)->keys
+                                              : ((node16 *)data)->keys;
+                value_type *s = kind == KIND4 ? ((node4 *)data)->slots()
+                                              : ((node16 *)data)->slots();
+                keys[count] = r;
+                new (&s[count]) value_type(std::move(v));
+                break;
+            }
+            case KIND48: {
+                node48 *n = (node48 *)data;
+                new (&n->slots()[count]) value_type(std::move(v));
+                n->index[r] = (uint8_t)(count + 1);
+                break;
+            }
+            case KIND256: {
+                node256 *n = (node256 *)data;
+                new (&n->slots()[r]) value_type(std::move(v));
+                n->present[r / 64] |= 1ull << (r % 64);
+                break;
+            }
+        }
+        count++;
+    }
+
+   private:
+    uint8_t kind = KIND0;
+    uint16_t count = 0;
+    void *data = nullptr;
+};
@@ -0,0 +1,561 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <regex>
+#include <string>
+
+#include "ConcurrentTrieTree.h"
+#include "FileScan.h"
+#include "RadixTree.h"
+#include "TrieTree.h"
+#include "skiplist.h"
+using namespace std;
+
+// 墙上时间(秒)
+double wall_time() {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+vector<string> read_words(const string &path) {
+    ifstream ifs(path);
+    string s((istreambuf_iterator<char>(ifs)), istreambuf_iterator<char>());
+    regex rgx("(\\w+)");
+    vector<string> words;
+    for (auto it = sregex_iterator(s.begin(), s.end(), rgx);
+         it != sregex_iterator(); it++)
+        words.push_back(it->str(1));
+    return words;
+}
+
+void bench_scan_file() {
+    // 以 text.txt 中的单词作为模式串, 重复 text.txt 生成 64MB 的测试文件
+    ifstream ifs("text.txt");
+    string text((istreambuf_iterator<char>(ifs)), istreambuf_iterator<char>());
+    const string path = "bench_scan.tmp";
+    {
+        ofstream ofs(path, ios::binary);
+        for (size_t n = 0; n < (64u << 20); n += text.size() + 1)
+            ofs << text << '\n';
+    }
+
+    AC_automaton<char> aca;
+    aca.buildTrieTree(read_words("text.txt"));
+    aca.buildAC_automaton();
+
+    for (int compiled = 0; compiled < 2; compiled++) {
+        if (compiled) aca.compile();
+        for (auto io : {scan_io::mmap, scan_io::read}) {
+            size_t matches = 0;
+            double t = wall_time();
+            int64_t bytes = scan_file(
+                aca, path, [&](const ac_match_t &) { matches++; }, io);
+            t = wall_time() - t;
+            cout << "scan_file\t" << (io == scan_io::mmap ? "mmap" : "read")
+                 << "\t" << (compiled ? "dfa" : "node") << "\t"
+                 << bytes / t / (1 << 20) << " MB/s\tmatches: " << matches
+                 << endl;
+        }
+    }
+    remove(path.c_str());
+}
+
+void bench_parallel_scan() {
+    // 在内存中的 128MB 文本上并行扫描
+    ifstream ifs("text.txt");
+    string text((istreambuf_iterator<char>(ifs)), istreambuf_iterator<char>());
+    string s;
+    while (s.size() < (128u << 20)) s += text + '\n';
+
+    AC_automaton<char> aca;
+    aca.buildTrieTree({"Linux", "distribution", "package", "software"});
+    aca.buildAC_automaton();
+    aca.compile();
+
+    unsigned hw = max(1u, thread::hardware_concurrency());
+    for (unsigned threads = 1; threads <= hw; threads *= 2) {
+        size_t matches = 0;
+        double t = wall_time();
+        aca.parallel_match(
+            s, [&](const ac_match_t &) { matches++; }, threads);
+        t = wall_time() - t;
+        cout << "parallel_match\tthreads: " << threads << "\t"
+             << s.size() / t / (1 << 20) << " MB/s\tmatches: " << matches
+             << endl;
+    }
+}
+
+vector<string> random_words(size_t n, int min_len, int max_len,
+                            int alphabet, unsigned seed = 1) {
+    mt19937 rng(seed);
+    vector<string> words(n);
+    for (auto &w : words) {
+        int len = min_len + rng() % (max_len - min_len + 1);
+        for (int i = 0; i < len; i++) w += (char)('a' + rng() % alphabet);
+    }
+    return words;
+}
+
+template <int Type, template <class> class Alloc>
+void bench_node_allocator(const char *name, const vector<string> &words) {
+    auto *trie = new TrieTree<char, Type, '\0', Alloc>();
+    double t0 = wall_time();
+    for (auto &w : words) trie->insert(w);
+    double t1 = wall_time();
+    trie->clear();
+    double t2 = wall_time();
+    delete trie;
+    cout << "node_allocator\tType " << Type << "\t" << name
+         << "\tinsert: " << t1 - t0 << " s\tclear: " << t2 - t1 << " s"
+         << endl;
+}
+
+template <int Type>
+void bench_insert_sorted(vector<string> words) {
+    sort(words.begin(), words.end());
+    double t_insert, t_sorted;
+    {
+        TrieTree<char, Type, '\0', arena_node_allocator> trie;
+        double t = wall_time();
+        for (auto &w : words) trie.insert(w);
+        t_insert = wall_time() - t;
+    }
+    {
+        TrieTree<char, Type, '\0', arena_node_allocator> trie;
+        double t = wall_time();
+        trie.insert_sorted(words.begin(), words.end());
+        t_sorted = wall_time() - t;
+    }
+    cout << "insert_sorted\tType " << Type << "\tinsert: "
+         << words.size() / t_insert << " keys/s\tinsert_sorted: "
+         << words.size() / t_sorted << " keys/s" << endl;
+}
+
+void bench_topk() {
+    // 次数服从 Zipf 分布的词典, 对短前缀取前 10 个补全
+    auto words = random_words(200000, 3, 12, 8, 7);
+    TrieTree<char, 1> trie;
+    for (size_t i = 0; i < words.size(); i++)
+        for (size_t n = 0; n < 1 + 1000 / (i + 1); n++) trie.insert(words[i]);
+    vector<string> prefixes;
+    for (int c = 0; c < 8; c++) prefixes.push_back(string(1, 'a' + c));
+
+    double t = wall_time();
+    size_t total = 0;
+    for (auto &p : prefixes) {
+        // 收集所有单词后排序, 重复的单词按次数计一次
+        map<string, int> counts;
+        for (auto &w : trie.prefixWords(p)) counts[w]++;
+        vector<pair<int, string>> v;
+        for (auto &[w, n] : counts) v.emplace_back(n, w);
+        partial_sort(v.begin(), v.begin() + min<size_t>(10, v.size()),
+                     v.end(), greater<>());
+        total += min<size_t>(10, v.size());
+    }
+    double t_all = wall_time() - t;
+
+    t = wall_time();
+    for (int r = 0; r < 100; r++)
+        for (auto &p : prefixes) total += trie.topK(p, 10).size();
+    double t_topk = (wall_time() - t) / 100;
+    cout << "topK	prefixWords+sort: " << t_all / prefixes.size() * 1e6
+         << " us/query	topK: " << t_topk / prefixes.size() * 1e6
+         << " us/query	(" << total << ")" << endl;
+}
+
+void bench_concurrent_read() {
+    // 读线程数增加时的查询吞吐, 同时有一个写线程持续更新
+    auto words = random_words(200000, 4, 12, 26, 11);
+    ConcurrentTrieTree<char> trie;
+    for (auto &w : words) trie.insert(w);
+    auto updates = random_words(10000, 4, 12, 26, 12);
+
+    unsigned hw = max(1u, thread::hardware_concurrency());
+    for (unsigned threads = 1; threads <= hw; threads *= 2) {
+        atomic<bool> stop{false};
+        thread writer([&] {
+            for (size_t i = 0; !stop; i++) {
+                auto &w = updates[i % updates.size()];
+                if (i / updates.size() % 2 == 0)
+                    trie.insert(w);
+                else
+                    trie.erase(w);
+            }
+        });
+        atomic<size_t> lookups{0}, hits{0};
+        vector<thread> readers;
+        double t = wall_time();
+        for (unsigned r = 0; r < threads; r++)
+            readers.emplace_back([&, r] {
+                size_t n = 0, found = 0;
+                for (size_t i = r; n < 2000000; i += threads, n++)
+                    found += trie.search(words[i % words.size()]);
+                lookups += n;
+                hits += found;
+            });
+        for (auto &th : readers) th.join();
+        t = wall_time() - t;
+        stop = true;
+        writer.join();
+        cout << "concurrent_read\tthreads: " << threads << "\t"
+             << lookups / t / 1e6 << " M lookups/s\thits: " << hits << endl;
+    }
+}
+
+/*
+ * 作为 bench_skiplist 的基准, 保留改为内联 tower 之前的跳表布局:
+ * 每个节点的 next 数组单独分配, 查找时不预取, 层数逐层抽取随机数
+ * */
+template <class KeyType, class ValueType>
+class tower_skiplist {
+   public:
+    struct node_t {
+        KeyType first;
+        ValueType second;
+        node_t **next;
+    };
+
+    explicit tower_skiplist(float prob = 0.5f, int max_level = 20)
+        : prob(prob), max_level(max_level) {
+        tail = new node_t{numeric_limits<KeyType>::max(), ValueType(),
+                          nullptr};
+        head = new node_t{KeyType(), ValueType(), new node_t *[max_level]};
+        for (int i = 0; i < max_level; i++) head->next[i] = tail;
+        update.resize(max_level);
+    }
+    ~tower_skiplist() {
+        for (node_t *x = head; x != tail;) {
+            node_t *y = x->next[0];
+            delete[] x->next;
+            delete x;
+            x = y;
+        }
+        delete tail;
+    }
+
+    node_t *find(const KeyType &key) {
+        node_t *x = head;
+        for (int i = cur_level - 1; i >= 0; i--)
+            while (x->next[i] != tail && x->next[i]->first < key)
+                x = x->next[i];
+        x = x->next[0];
+        return x != tail && x->first == key ? x : nullptr;
+    }
+    ValueType &operator[](const KeyType &key) {
+        node_t *x = __search(key);
+        if (x != tail && x->first == key) return x->second;
+        int level = random_level();
+        if (level > cur_level) {
+            for (int i = cur_level; i < level; i++) update[i] = head;
+            cur_level = level;
+        }
+        x = new node_t{key, ValueType(), new node_t *[level]};
+        for (int i = 0; i < level; i++) {
+            x->next[i] = update[i]->next[i];
+            update[i]->next[i] = x;
+        }
+        return x->second;
+    }
+    bool erase(const KeyType &key) {
+        node_t *x = __search(key);
+        if (x == tail || x->first != key) return false;
+        for (int i = 0; i < cur_level && update[i]->next[i] == x; i++)
+            update[i]->next[i] = x->next[i];
+        while (cur_level > 1 && head->next[cur_level - 1] == tail) cur_level--;
+        delete[] x->next;
+        delete x;
+        return true;
+    }
+
+   private:
+    node_t *__search(const KeyType &key) {
+        node_t *x = head;
+        for (int i = cur_level - 1; i >= 0; i--) {
+            while (x->next[i] != tail && x->next[i]->first < key)
+                x = x->next[i];
+            update[i] = x;
+        }
+        return x->next[0];
+    }
+    int random_level() {
+        thread_local minstd_rand rng(random_device{}());
+        uniform_real_distribution<float> dist(0.0f, 1.0f);
+        int level = 1;
+        while (dist(rng) < prob && level < max_level) level++;
+        return level;
+    }
+
+    float prob;
+    int max_level;
+    int cur_level = 0;
+    node_t *head, *tail;
+    vector<node_t *> update;
+};
+
+template <class Map>
+void bench_ordered_map(const char *name, Map &m, const vector<int> &keys) {
+    double t = wall_time();
+    for (int k : keys) m[k] = k;
+    double t_insert = wall_time() - t;
+    t = wall_time();
+    long sum = 0;
+    for (int k : keys) sum += m.find(k)->second;
+    double t_find = wall_time() - t;
+    t = wall_time();
+    for (int k : keys) m.erase(k);
+    double t_erase = wall_time() - t;
+    cout << name << "\tinsert: " << t_insert / keys.size() * 1e9
+         << " ns\tfind: " << t_find / keys.size() * 1e9
+         << " ns\terase: " << t_erase / keys.size() * 1e9 << " ns\t(" << sum
+         << ")" << endl;
+}
+
+void bench_skiplist() {
+    // 随机 key, 数据量远大于缓存
+    vector<int> keys(1000000);
+    mt19937 rng(5);
+    for (auto &k : keys) k = (int)(rng() >> 1);
+    tower_skiplist<int, int> old(0.5f, 20);
+    bench_ordered_map("skiplist (separate towers)", old, keys);
+    skiplist<int, int> sl(0.5f, numeric_limits<int>::max(), 20);
+    bench_ordered_map("skiplist", sl, keys);
+    map<int, int> m;
+    bench_ordered_map("std::map", m, keys);
+}
+
+template <int Type>
+void bench_child_container(const vector<string> &words) {
+    TrieTree<char, Type, '\0', arena_node_allocator> trie;
+    double t = wall_time();
+    for (auto &w : words) trie.insert(w);
+    double t_insert = wall_time() - t;
+    t = wall_time();
+    size_t found = 0;
+    for (auto &w : words) found += trie.search(w) != nullptr;
+    double t_search = wall_time() - t;
+    cout << "child_container\tType " << Type
+         << "\tinsert: " << t_insert / words.size() * 1e9
+         << " ns\tsearch: " << t_search / words.size() * 1e9 << " ns\t("
+         << found << ")" << endl;
+}
+
+// 类似 URL 的长 key: 少量的公共前缀加上较长的随机路径
+vector<string> random_urls(size_t n, unsigned seed) {
+    auto hosts = random_words(100, 6, 12, 26, seed);
+    auto parts = random_words(n * 3, 4, 10, 26, seed + 1);
+    mt19937 rng(seed);
+    vector<string> urls(n);
+    for (size_t i = 0; i < n; i++)
+        urls[i] = "https://" + hosts[rng() % hosts.size()] + ".com/" +
+                  parts[i * 3] + "/" + parts[i * 3 + 1] + "/" +
+                  parts[i * 3 + 2] + ".html";
+    return urls;
+}
+
+template <class Tree>
+void bench_long_keys(const char *name, const vector<string> &keys) {
+    Tree tree;
+    double t = wall_time();
+    for (auto &k : keys) tree.insert(k);
+    double t_insert = wall_time() - t;
+    t = wall_time();
+    size_t found = 0;
+    for (auto &k : keys) found += tree.count(k) > 0;
+    double t_count = wall_time() - t;
+    cout << "long_keys\t" << name
+         << "\tinsert: " << t_insert / keys.size() * 1e9
+         << " ns\tcount: " << t_count / keys.size() * 1e9 << " ns\t("
+         << found << ")" << endl;
+}
+
+// 大的 trie 上随机顺序的查找, 一半命中: 逐个 search 与 search_batch
+template <int Type>
+void bench_batch_lookup(const vector<string> &words) {
+    TrieTree<char, Type> trie;
+    for (size_t i = 0; i < words.size(); i += 2) trie.insert(words[i]);
+    vector<string> queries = words;
+    shuffle(queries.begin(), queries.end(), mt19937(5));
+    double t = wall_time();
+    size_t found = 0;
+    for (auto &q : queries) found += trie.search(q) != nullptr;
+    double t_single = wall_time() - t;
+    t = wall_time();
+    auto nodes = trie.search_batch(queries);
+    double t_batch = wall_time() - t;
+    size_t found_batch = 0;
+    for (auto x : nodes) found_batch += x != nullptr;
+    cout << "batch_lookup\tType " << Type
+         << "\tsearch: " << t_single / queries.size() * 1e9
+         << " ns\tsearch_batch: " << t_batch / queries.size() * 1e9
+         << " ns\t(" << found << " " << found_batch << ")" << endl;
+}
+
+// 修改前的查找方式: 每个字符先 find 再 operator[], 查找两次
+template <class Tree>
+typename Tree::node_pointer two_probe_search(Tree &trie, const string &s) {
+    auto x = trie.get_root();
+    for (char c : s) {
+        if (x->children.find(c) == x->children.end()) return nullptr;
+        x = x->children[c];
+    }
+    return x->isLeaf ? x : nullptr;
+}
+
+// 每个字符的平均耗时: 插入/查找只访问一次孩子容器, 与查找两次对比
+template <int Type>
+void bench_single_probe(const vector<string> &words) {
+    size_t chars = 0;
+    for (auto &w : words) chars += w.size();
+    TrieTree<char, Type, '\0', arena_node_allocator> trie;
+    double t = wall_time();
+    for (auto &w : words) trie.insert(w);
+    double t_insert = wall_time() - t;
+    t = wall_time();
+    size_t found = 0;
+    for (auto &w : words) found += trie.search(w) != nullptr;
+    double t_search = wall_time() - t;
+    t = wall_time();
+    size_t found2 = 0;
+    for (auto &w : words) found2 += two_probe_search(trie, w) != nullptr;
+    double t_two = wall_time() - t;
+    t = wall_time();
+    for (auto &w : words) trie.erase(w);
+    double t_erase = wall_time() - t;
+    cout << "single_probe\tType " << Type
+         << "\tinsert: " << t_insert / chars * 1e9
+         << " ns/char\tsearch: " << t_search / chars * 1e9
+         << " ns/char\ttwo-probe search: " << t_two / chars * 1e9
+         << " ns/char\terase: " << t_erase / chars * 1e9 << " ns/char\t("
+         << found << " " << found2 << ")" << endl;
+}
+
+// 逐个计算编辑距离的基准
+size_t edit_distance(const string &a, const string &b) {
+    vector<size_t> prev(b.size() + 1), row(b.size() + 1);
+    for (size_t j = 0; j <= b.size(); j++) prev[j] = j;
+    for (size_t i = 1; i <= a.size(); i++) {
+        row[0] = i;
+        for (size_t j = 1; j <= b.size(); j++)
+            row[j] = min({prev[j] + 1, row[j - 1] + 1,
+                          prev[j - 1] + (a[i - 1] != b[j - 1])});
+        swap(prev, row);
+    }
+    return prev[b.size()];
+}
+
+template <int Type>
+void bench_fuzzy(const vector<string> &words) {
+    TrieTree<char, Type> trie;
+    for (auto &w : words) trie.insert(w);
+    // 对字典中的单词做一次随机的替换/插入/删除作为查询
+    mt19937 rng(61);
+    vector<string> queries;
+    for (size_t i = 0; i < 1000; i++) {
+        string q = words[rng() % words.size()];
+        size_t pos = rng() % q.size();
+        char c = 'a' + rng() % 26;
+        switch (rng() % 3) {
+            case 0: q[pos] = c; break;
+            case 1: q.insert(q.begin() + pos, c); break;
+            default: q.erase(q.begin() + pos);
+        }
+        queries.push_back(q);
+    }
+    for (size_t k = 1; k <= 2; k++) {
+        vector<double> latency;
+        size_t found = 0;
+        for (auto &q : queries) {
+            double t = wall_time();
+            found += trie.fuzzy(q, k).size();
+            latency.push_back(wall_time() - t);
+        }
+        sort(latency.begin(), latency.end());
+        double sum = 0;
+        for (double t : latency) sum += t;
+        cout << "fuzzy\tType " << Type << "\tk = " << k
+             << "\tavg: " << sum / latency.size() * 1e6
+             << " us\tp99: " << latency[latency.size() * 99 / 100] * 1e6
+             << " us\t(" << found << ")" << endl;
+    }
+    // 逐个单词计算编辑距离, 只测几个查询
+    double t = wall_time();
+    size_t found = 0;
+    for (size_t i = 0; i < 3; i++)
+        for (auto &w : words) found += edit_distance(w, queries[i]) <= 1;
+    cout << "fuzzy\tlinear scan\tk = 1\tavg: "
+         << (wall_time() - t) / 3 * 1e6 << " us\t(" << found << ")" << endl;
+}
+
+template <int Type>
+void bench_glob(const vector<string> &words) {
+    TrieTree<char, Type> trie;
+    for (auto &w : words) trie.insert(w);
+    for (string pattern : {"err?r*", "[a-f]*log", "qu?ck*", "*zz", "a*b*c"}) {
+        double t = wall_time();
+        size_t found = 0;
+        trie.glob(pattern, [&](const string &, int count) { found += count; });
+        double t_trie = wall_time() - t;
+        // 逐个单词匹配
+        t = wall_time();
+        glob_pattern<char> g(pattern);
+        size_t found_scan = 0;
+        for (auto &w : words) found_scan += g.match(w);
+        double t_scan = wall_time() - t;
+        cout << "glob\tType " << Type << "\t" << pattern
+             << "\ttrie: " << t_trie * 1e6 << " us\tscan: " << t_scan * 1e6
+             << " us\t(" << found << " " << found_scan << ")" << endl;
+    }
+}
+
+int main() {
+    bench_scan_file();
+    bench_parallel_scan();
+
+    auto words = random_words(1000000, 4, 16, 26);
+    bench_node_allocator<0, heap_node_allocator>("heap", words);
+    bench_node_allocator<0, arena_node_allocator>("arena", words);
+    bench_node_allocator<1, heap_node_allocator>("heap", words);
+    bench_node_allocator<1, arena_node_allocator>("arena", words);
+
+    bench_insert_sorted<0>(words);
+    bench_insert_sorted<1>(words);
+    bench_insert_sorted<2>(random_words(200000, 4, 16, 26));
+
+    bench_topk();
+    bench_concurrent_read();
+    bench_skiplist();
+
+    auto dict = random_words(300000, 3, 12, 26, 21);
+    bench_child_container<0>(dict);
+    bench_child_container<1>(dict);
+    bench_child_container<2>(dict);
+    bench_child_container<3>(dict);
+
+    auto urls = random_urls(200000, 31);
+    bench_long_keys<TrieTree<char, 0>>("TrieTree<char, 0>", urls);
+    bench_long_keys<TrieTree<char, 3>>("TrieTree<char, 3>", urls);
+    bench_long_keys<RadixTree<char>>("RadixTree", urls);
+
+    auto lookups = random_words(1000000, 6, 16, 26, 41);
+    bench_batch_lookup<0>(lookups);
+    bench_batch_lookup<1>(lookups);
+    bench_batch_lookup<3>(lookups);
+
+    auto probe_words = random_words(100000, 4, 12, 6, 51);
+    bench_single_probe<0>(probe_words);
+    bench_single_probe<1>(probe_words);
+    bench_single_probe<2>(probe_words);
+    bench_single_probe<3>(probe_words);
+
+    bench_fuzzy<0>(words);
+    bench_fuzzy<3>(words);
+
+    bench_glob<0>(words);
+    bench_glob<3>(words);
+    return 0;
+}
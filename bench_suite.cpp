@@ -0,0 +1,409 @@
+/*
+ * 可复现的基准测试
+ * 由随机数种子生成合成语料(key 的个数, 长度分布和字母表大小可以配置),
+ * 测量各种孩子容器的 TrieTree 的 insert/search/erase/prefixWords, AC 自动机
+ * 的构建时间和扫描速度, 以及 skiplist 与 std::map 的对比.
+ * 每个操作按批计时, 输出每个操作耗时(ns)的平均值和分位数, 以及内存占用和
+ * 分配次数(替换全局的 operator new/delete 统计). --json 输出机器可读的结果,
+ * 用于比较不同版本之间的性能变化
+ *
+ * g++ bench_suite.cpp -o bench_suite -std=c++2a -O2 -pthread
+ * ./bench_suite --keys 200000 --alphabet 26 --json > result.json
+ * */
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <new>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "TrieTree.h"
+#include "skiplist.h"
+using namespace std;
+
+// 全局分配统计, 基准测试是单线程的
+namespace alloc_stats {
+size_t count = 0;
+size_t live = 0;
+}  // namespace alloc_stats
+
+// 每块内存前保存大小, 保持 16 字节对齐
+static constexpr size_t ALLOC_HEADER = 16;
+
+// 不内联, 否则编译器会把 free 与调用者中的 operator new 配对并给出警告
+[[gnu::noinline]] static void *__counted_malloc(size_t n) {
+    void *p = malloc(n + ALLOC_HEADER);
+    if (!p) throw bad_alloc();
+    *(size_t *)p = n;
+    alloc_stats::count++;
+    alloc_stats::live += n;
+    return (char *)p + ALLOC_HEADER;
+}
+[[gnu::noinline]] static void __counted_free(void *p) {
+    if (!p) return;
+    char *b = (char *)p - ALLOC_HEADER;
+    alloc_stats::live -= *(size_t *)b;
+    free(b);
+}
+
+void *operator new(size_t n) { return __counted_malloc(n); }
+void *operator new[](size_t n) { return __counted_malloc(n); }
+void operator delete(void *p) noexcept { __counted_free(p); }
+void operator delete[](void *p) noexcept { operator delete(p); }
+void operator delete(void *p, size_t) noexcept { operator delete(p); }
+void operator delete[](void *p, size_t) noexcept { operator delete(p); }
+
+struct config_t {
+    size_t keys = 200000;
+    int min_len = 4;
+    int max_len = 16;
+    int alphabet = 26;
+    // uniform: 长度在 [min_len, max_len] 上均匀分布
+    // geometric: min_len 加上参数为 1/4 的几何分布, 不超过 max_len
+    string length_dist = "uniform";
+    int prefix_len = 3;
+    size_t patterns = 1000;
+    size_t text_mb = 16;
+    int repeat = 5;
+    unsigned seed = 1;
+    bool json = false;
+};
+
+// 一项测量结果: (名称, 值) 按加入的顺序输出
+struct result_t {
+    string bench, variant, op;
+    vector<pair<string, double>> values;
+};
+
+class bench_suite {
+   public:
+    // 每批的操作个数, 批的平均耗时作为一个样本
+    static constexpr size_t BATCH = 256;
+
+    explicit bench_suite(const config_t &cfg) : cfg(cfg), rng(cfg.seed) {
+        keys = __random_keys(cfg.keys);
+        // 与 keys 大多不重复的 key, 用于查找失败的情况
+        misses = __random_keys(cfg.keys);
+        for (auto &k : misses) k.push_back('#');
+        for (size_t i = 0; i < keys.size() && prefixes.size() < 2000;
+             i += max<size_t>(1, keys.size() / 2000))
+            prefixes.push_back(keys[i].substr(0, cfg.prefix_len));
+    }
+
+    void run() {
+        __trie<0>("Type 0");
+        __trie<1>("Type 1");
+        __trie<2>("Type 2");
+        __trie<3>("Type 3");
+        __ac<0>("Type 0");
+        __ac<1>("Type 1");
+        __ac<3>("Type 3");
+        __ordered_map<skiplist<int, int>>("skiplist");
+        __ordered_map<map<int, int>>("std::map");
+    }
+
+    void print() const {
+        if (cfg.json) {
+            __print_json();
+            return;
+        }
+        for (auto &r : results) {
+            cout << r.bench << "\t" << r.variant << "\t" << r.op;
+            for (auto &[name, value] : r.values)
+                cout << "\t" << name << ": " << value;
+            cout << endl;
+        }
+    }
+
+   private:
+    using clock = chrono::steady_clock;
+    using samples_t = vector<double>;
+
+    vector<string> __random_keys(size_t n) {
+        vector<string> v(n);
+        geometric_distribution<int> geo(0.25);
+        for (auto &k : v) {
+            int len = cfg.length_dist == "geometric"
+                          ? min(cfg.max_len, cfg.min_len + geo(rng))
+                          : cfg.min_len +
+                                (int)(rng() % (cfg.max_len - cfg.min_len + 1));
+            for (int i = 0; i < len; i++)
+                k.push_back((char)('a' + rng() % cfg.alphabet));
+        }
+        return v;
+    }
+
+    static double __elapsed_ns(clock::time_point t) {
+        return chrono::duration<double, nano>(clock::now() - t).count();
+    }
+
+    // 对 [0, n) 分批调用 op(i), 每批一个样本(每个操作的 ns)
+    template <class F>
+    static void __timed(size_t n, samples_t &samples, F &&op) {
+        for (size_t i = 0; i < n; i += BATCH) {
+            size_t e = min(n, i + BATCH);
+            auto t = clock::now();
+            for (size_t j = i; j < e; j++) op(j);
+            samples.push_back(__elapsed_ns(t) / (e - i));
+        }
+    }
+
+    // 平均值和分位数
+    void __add(const string &bench, const string &variant, const string &op,
+               samples_t samples, size_t ops) {
+        // 没有样本时不输出结果
+        if (samples.empty()) return;
+        sort(samples.begin(), samples.end());
+        auto pct = [&](double q) {
+            return samples[min(samples.size() - 1,
+                               (size_t)(q * samples.size()))];
+        };
+        double sum = 0;
+        for (double s : samples) sum += s;
+        results.push_back(result_t{bench,
+                                   variant,
+                                   op,
+                                   {{"ops", (double)ops},
+                                    {"mean_ns", sum / samples.size()},
+                                    {"p50_ns", pct(0.5)},
+                                    {"p90_ns", pct(0.9)},
+                                    {"p99_ns", pct(0.99)},
+                                    {"max_ns", samples.back()}}});
+    }
+
+    template <int Type>
+    void __trie(const string &variant) {
+        samples_t insert, hit, miss, prefix, erase;
+        size_t bytes = 0, allocs = 0, found = 0;
+        for (int r = 0; r < cfg.repeat; r++) {
+            size_t live = alloc_stats::live, count = alloc_stats::count;
+            auto *trie = new TrieTree<char, Type>();
+            __timed(keys.size(), insert,
+                    [&](size_t i) { trie->insert(keys[i]); });
+            bytes = alloc_stats::live - live;
+            allocs = alloc_stats::count - count;
+            __timed(keys.size(), hit, [&](size_t i) {
+                found += trie->search(keys[i]) != nullptr;
+            });
+            __timed(misses.size(), miss, [&](size_t i) {
+                found += trie->search(misses[i]) != nullptr;
+            });
+            for (size_t i = 0; i < prefixes.size(); i += 16) {
+                size_t e = min(prefixes.size(), i + 16), words = 0;
+                auto t = clock::now();
+                for (size_t j = i; j < e; j++)
+                    words += trie->prefixWords(prefixes[j]).size();
+                prefix.push_back(__elapsed_ns(t) / (e - i));
+                found += words;
+            }
+            __timed(keys.size(), erase,
+                    [&](size_t i) { trie->erase(keys[i]); });
+            delete trie;
+        }
+        size_t n = keys.size() * cfg.repeat;
+        __add("trie", variant, "insert", insert, n);
+        __add("trie", variant, "search_hit", hit, n);
+        __add("trie", variant, "search_miss", miss, n);
+        __add("trie", variant, "prefixWords", prefix,
+              prefixes.size() * cfg.repeat);
+        __add("trie", variant, "erase", erase, n);
+        results.push_back(
+            result_t{"trie",
+                     variant,
+                     "memory",
+                     {{"bytes", (double)bytes},
+                      {"bytes_per_key", (double)bytes / keys.size()},
+                      {"allocs_per_key", (double)allocs / keys.size()},
+                      {"checksum", (double)found}}});
+    }
+
+    // 随机文本中按 1/8 的概率插入一个模式串
+    string __text(const vector<string> &pats) {
+        string text;
+        size_t size = cfg.text_mb << 20;
+        text.reserve(size + cfg.max_len);
+        while (text.size() < size) {
+            if (rng() % 8 == 0)
+                text += pats[rng() % pats.size()];
+            else
+                text.push_back((char)('a' + rng() % cfg.alphabet));
+        }
+        return text;
+    }
+
+    template <int Type>
+    void __ac(const string &variant) {
+        vector<string> pats(keys.begin(),
+                            keys.begin() + min(cfg.patterns, keys.size()));
+        sort(pats.begin(), pats.end());
+        if (text.empty()) text = __text(pats);
+        samples_t build, compile, scan_node, scan_dfa;
+        size_t bytes = 0, matches = 0;
+        const size_t chunk = 1 << 20;
+        for (int r = 0; r < cfg.repeat; r++) {
+            size_t live = alloc_stats::live;
+            auto *ac = new AC_automaton<char, Type>();
+            auto t = clock::now();
+            ac->buildTrieTree(pats);
+            ac->buildAC_automaton();
+            build.push_back(__elapsed_ns(t));
+            for (int compiled = 0; compiled < 2; compiled++) {
+                if (compiled) {
+                    t = clock::now();
+                    ac->compile();
+                    compile.push_back(__elapsed_ns(t));
+                    bytes = alloc_stats::live - live;
+                }
+                // 每 1MB 一个样本(每字节的 ns)
+                for (size_t i = 0; i < text.size(); i += chunk) {
+                    size_t n = min(chunk, text.size() - i);
+                    t = clock::now();
+                    ac->match(string_view(text.data() + i, n),
+                              [&](const ac_match_t &) { matches++; });
+                    (compiled ? scan_dfa : scan_node)
+                        .push_back(__elapsed_ns(t) / n);
+                }
+            }
+            delete ac;
+        }
+        __add("ac", variant, "build", build, cfg.repeat);
+        __add("ac", variant, "compile", compile, cfg.repeat);
+        __add("ac", variant, "scan_node", scan_node, text.size() * cfg.repeat);
+        __add("ac", variant, "scan_dfa", scan_dfa, text.size() * cfg.repeat);
+        // 每字节的 ns 换算为 MB/s
+        auto mbps = [](const result_t &r) {
+            return 1e9 / r.values[1].second / (1 << 20);
+        };
+        double node = mbps(results[results.size() - 2]);
+        double dfa = mbps(results.back());
+        results.push_back(result_t{"ac",
+                                   variant,
+                                   "throughput",
+                                   {{"scan_node_mb_s", node},
+                                    {"scan_dfa_mb_s", dfa},
+                                    {"bytes", (double)bytes},
+                                    {"matches", (double)matches}}});
+    }
+
+    template <class Map>
+    void __ordered_map(const string &variant) {
+        vector<int> ints(keys.size());
+        for (size_t i = 0; i < ints.size(); i++) ints[i] = (int)i;
+        shuffle(ints.begin(), ints.end(), rng);
+        samples_t insert, find, erase;
+        size_t bytes = 0, allocs = 0, found = 0;
+        for (int r = 0; r < cfg.repeat; r++) {
+            size_t live = alloc_stats::live, count = alloc_stats::count;
+            auto *m = new Map();
+            __timed(ints.size(), insert,
+                    [&](size_t i) { m->try_emplace(ints[i], ints[i]); });
+            bytes = alloc_stats::live - live;
+            allocs = alloc_stats::count - count;
+            __timed(ints.size(), find, [&](size_t i) {
+                found += m->find(ints[i]) != m->end();
+            });
+            __timed(ints.size(), erase, [&](size_t i) { m->erase(ints[i]); });
+            delete m;
+        }
+        size_t n = ints.size() * cfg.repeat;
+        __add("ordered_map", variant, "insert", insert, n);
+        __add("ordered_map", variant, "find", find, n);
+        __add("ordered_map", variant, "erase", erase, n);
+        results.push_back(
+            result_t{"ordered_map",
+                     variant,
+                     "memory",
+                     {{"bytes", (double)bytes},
+                      {"bytes_per_key", (double)bytes / ints.size()},
+                      {"allocs_per_key", (double)allocs / ints.size()},
+                      {"checksum", (double)found}}});
+    }
+
+    void __print_json() const {
+        cout.precision(10);
+        cout << "{\n  \"config\": {\"keys\": " << cfg.keys
+             << ", \"min_len\": " << cfg.min_len
+             << ", \"max_len\": " << cfg.max_len
+             << ", \"alphabet\": " << cfg.alphabet
+             << ", \"length_dist\": \"" << cfg.length_dist
+             << "\", \"prefix_len\": " << cfg.prefix_len
+             << ", \"patterns\": " << cfg.patterns
+             << ", \"text_mb\": " << cfg.text_mb
+             << ", \"repeat\": " << cfg.repeat << ", \"seed\": " << cfg.seed
+             << "},\n  \"results\": [";
+        for (size_t i = 0; i < results.size(); i++) {
+            auto &r = results[i];
+            cout << (i ? ",\n" : "\n") << "    {\"bench\": \"" << r.bench
+                 << "\", \"variant\": \"" << r.variant << "\", \"op\": \""
+                 << r.op << "\"";
+            for (auto &[name, value] : r.values)
+                cout << ", \"" << name << "\": " << value;
+            cout << "}";
+        }
+        cout << "\n  ]\n}" << endl;
+    }
+
+   private:
+    config_t cfg;
+    mt19937 rng;
+    vector<string> keys, misses, prefixes;
+    string text;
+    vector<result_t> results;
+};
+
+static void usage(const char *name) {
+    cerr << "usage: " << name
+         << " [--keys N] [--min-len N] [--max-len N] [--alphabet N]\n"
+            "       [--length-dist uniform|geometric] [--prefix-len N]\n"
+            "       [--patterns N] [--text-mb N] [--repeat N] [--seed N]"
+            " [--json]"
+         << endl;
+}
+
+int main(int argc, char **argv) {
+    config_t cfg;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--json") {
+            cfg.json = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        string v = argv[++i];
+        if (arg == "--keys") cfg.keys = stoul(v);
+        else if (arg == "--min-len") cfg.min_len = stoi(v);
+        else if (arg == "--max-len") cfg.max_len = stoi(v);
+        else if (arg == "--alphabet") cfg.alphabet = stoi(v);
+        else if (arg == "--length-dist") cfg.length_dist = v;
+        else if (arg == "--prefix-len") cfg.prefix_len = stoi(v);
+        else if (arg == "--patterns") cfg.patterns = stoul(v);
+        else if (arg == "--text-mb") cfg.text_mb = stoul(v);
+        else if (arg == "--repeat") cfg.repeat = stoi(v);
+        else if (arg == "--seed") cfg.seed = (unsigned)stoul(v);
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    // 查找失败的 key 使用字母表之外的字符
+    if (cfg.keys == 0 || cfg.patterns == 0 || cfg.text_mb == 0 ||
+        cfg.repeat <= 0 || cfg.min_len < 1 ||
+        cfg.max_len < cfg.min_len || cfg.alphabet < 1 || cfg.alphabet > 26 ||
+        (cfg.length_dist != "uniform" && cfg.length_dist != "geometric")) {
+        usage(argv[0]);
+        return 1;
+    }
+    bench_suite suite(cfg);
+    suite.run();
+    suite.print();
+    return 0;
+}
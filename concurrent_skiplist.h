@@ -0,0 +1,276 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+#include "EpochReclaimer.h"
+#include "SkiplistLevel.h"
+
+/*
+ * 并发跳表 (lazy skiplist)
+ * 查找不加锁也不写任何共享数据, 只沿着 next 指针前进, 是 wait-free 的;
+ * 插入/删除只锁住受影响的前驱节点和被删除的节点(每个节点一个自旋锁),
+ * 不同位置的修改可以并行.
+ * 节点先在第0层链入, 所有层都链入后才标记 fullyLinked; 删除时先标记
+ * marked(逻辑删除) 再逐层摘除(物理删除), 摘除后的节点交给
+ * epoch_reclaimer 延迟释放, 正在遍历的线程不会访问到已释放的节点.
+ * 层数由每个线程自己的随机数发生器生成, 与 skiplist 相同(SkiplistLevel.h).
+ * 读线程进入 epoch 临界区(pin)时不会等待, 见 EpochReclaimer.h
+ * */
+template <class KeyType, class ValueType>
+class concurrent_skiplist {
+   public:
+    using key_type = KeyType;
+    using const_key_type = const key_type &;
+    using value_type = ValueType;
+    using const_reference_value_type = const value_type &;
+
+    static constexpr int MAX_LEVEL = 16;
+    // 累计的 retire 个数达到该值时回收一次
+    static constexpr size_t RECLAIM_THRESHOLD = 64;
+
+    explicit concurrent_skiplist(float prob = 0.5f)
+        : m_levelGen(prob, MAX_LEVEL) {
+        m_headNode = new node_type(key_type(), value_type(), MAX_LEVEL);
+        m_tailNode = new node_type(key_type(), value_type(), MAX_LEVEL);
+        for (int i = 0; i < MAX_LEVEL; i++)
+            m_headNode->next[i].store(m_tailNode, std::memory_order_relaxed);
+        m_headNode->fullyLinked = true;
+        m_tailNode->fullyLinked = true;
+    }
+    concurrent_skiplist(const concurrent_skiplist &) = delete;
+    concurrent_skiplist &operator=(const concurrent_skiplist &) = delete;
+    // 析构时不能再有其他线程访问
+    ~concurrent_skiplist() {
+        node_type *x = m_headNode;
+        while (x != m_tailNode) {
+            node_type *y = x->next[0].load(std::memory_order_relaxed);
+            delete x;
+            x = y;
+        }
+        delete m_tailNode;
+    }
+
+    // 插入 (key, value), key 已经存在时不修改并返回 false
+    bool insert(const_key_type key, const_reference_value_type value) {
+        int level = random_level();
+        node_type *preds[MAX_LEVEL], *succs[MAX_LEVEL];
+        auto guard = m_reclaimer.pin();
+        while (true) {
+            int found = __find(key, preds, succs);
+            if (found != -1) {
+                node_type *x = succs[found];
+                if (!x->marked.load(std::memory_order_acquire)) {
+                    // 等待正在插入的节点链接完成
+                    while (!x->fullyLinked.load(std::memory_order_acquire))
+                        std::this_thread::yield();
+                    return false;
+                }
+                // 节点正在被删除, 重试
+                continue;
+            }
+            // 自底向上锁住前驱节点并检查它们仍然相邻
+            int highestLocked = -1;
+            node_type *prevPred = nullptr;
+            bool valid = true;
+            for (int i = 0; valid && i < level; i++) {
+                node_type *pred = preds[i], *succ = succs[i];
+                if (pred != prevPred) {
+                    pred->lock();
+                    highestLocked = i;
+                    prevPred = pred;
+                }
+                valid = !pred->marked.load(std::memory_order_acquire) &&
+                        !succ->marked.load(std::memory_order_acquire) &&
+                        pred->next[i].load(std::memory_order_acquire) == succ;
+            }
+            if (!valid) {
+                __unlock(preds, highestLocked);
+                continue;
+            }
+            node_type *x = new node_type(key, value, level);
+            for (int i = 0; i < level; i++)
+                x->next[i].store(succs[i], std::memory_order_relaxed);
+            for (int i = 0; i < level; i++)
+                preds[i]->next[i].store(x, std::memory_order_release);
+            x->fullyLinked.store(true, std::memory_order_release);
+            __unlock(preds, highestLocked);
+            m_size.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    // 删除 key, 不存在时返回 false
+    bool erase(const_key_type key) {
+        node_type *victim = nullptr;
+        bool isMarked = false;
+        int level = -1;
+        node_type *preds[MAX_LEVEL], *succs[MAX_LEVEL];
+        auto guard = m_reclaimer.pin();
+        while (true) {
+            int found = __find(key, preds, succs);
+            if (found != -1) victim = succs[found];
+            if (!isMarked &&
+                (found == -1 ||
+                 !victim->fullyLinked.load(std::memory_order_acquire) ||
+                 victim->level - 1 != found ||
+                 victim->marked.load(std::memory_order_acquire)))
+                return false;
+            if (!isMarked) {
+                level = victim->level;
+                victim->lock();
+                if (victim->marked.load(std::memory_order_relaxed)) {
+                    victim->unlock();
+                    return false;
+                }
+                // 逻辑删除: 之后的查找都认为 key 不存在
+                victim->marked.store(true, std::memory_order_release);
+                isMarked = true;
+            }
+            int highestLocked = -1;
+            node_type *prevPred = nullptr;
+            bool valid = true;
+            for (int i = 0; valid && i < level; i++) {
+                node_type *pred = preds[i];
+                if (pred != prevPred) {
+                    pred->lock();
+                    highestLocked = i;
+                    prevPred = pred;
+                }
+                valid = !pred->marked.load(std::memory_order_acquire) &&
+                        pred->next[i].load(std::memory_order_acquire) ==
+                            victim;
+            }
+            if (!valid) {
+                __unlock(preds, highestLocked);
+                continue;
+            }
+            for (int i = level - 1; i >= 0; i--)
+                preds[i]->next[i].store(
+                    victim->next[i].load(std::memory_order_relaxed),
+                    std::memory_order_release);
+            victim->unlock();
+            __unlock(preds, highestLocked);
+            m_size.fetch_sub(1, std::memory_order_relaxed);
+            __retire(victim);
+            return true;
+        }
+    }
+
+    // 是否包含 key, 不加锁
+    bool contains(const_key_type key) {
+        auto guard = m_reclaimer.pin();
+        node_type *x = __find_node(key);
+        return x != nullptr;
+    }
+
+    // 查找 key 对应的值, 不加锁
+    std::optional<value_type> find(const_key_type key) {
+        auto guard = m_reclaimer.pin();
+        node_type *x = __find_node(key);
+        if (!x) return std::nullopt;
+        return x->value;
+    }
+
+    // 按 key 从小到大遍历当前存在的元素, 不加锁, 不保证是同一时刻的快照
+    template <class F>
+    void for_each(F &&visit) {
+        auto guard = m_reclaimer.pin();
+        node_type *x = m_headNode->next[0].load(std::memory_order_acquire);
+        for (; x != m_tailNode; x = x->next[0].load(std::memory_order_acquire))
+            if (x->fullyLinked.load(std::memory_order_acquire) &&
+                !x->marked.load(std::memory_order_acquire))
+                visit(x->key, x->value);
+    }
+
+    size_t size() const { return m_size.load(std::memory_order_relaxed); }
+    bool empty() const { return size() == 0; }
+
+   private:
+    struct node_type {
+        const key_type key;
+        value_type value;
+        const int level;
+        std::atomic<node_type *> next[MAX_LEVEL];
+        std::atomic<bool> marked{false};
+        std::atomic<bool> fullyLinked{false};
+        std::atomic_flag spin = ATOMIC_FLAG_INIT;
+
+        node_type(const_key_type key, const_reference_value_type value,
+                  int level)
+            : key(key), value(value), level(level) {}
+
+        void lock() {
+            while (spin.test_and_set(std::memory_order_acquire))
+                std::this_thread::yield();
+        }
+        void unlock() { spin.clear(std::memory_order_release); }
+    };
+
+    /*
+     * 从上到下查找 key, 保存每一层的前驱和后继,
+     * 返回 key 所在节点出现的最高层, 不存在时返回 -1
+     */
+    int __find(const_key_type key, node_type **preds, node_type **succs) {
+        int found = -1;
+        node_type *pred = m_headNode;
+        for (int i = MAX_LEVEL - 1; i >= 0; i--) {
+            node_type *cur = pred->next[i].load(std::memory_order_acquire);
+            while (cur != m_tailNode && cur->key < key) {
+                pred = cur;
+                cur = pred->next[i].load(std::memory_order_acquire);
+            }
+            if (found == -1 && cur != m_tailNode && cur->key == key)
+                found = i;
+            preds[i] = pred;
+            succs[i] = cur;
+        }
+        return found;
+    }
+
+    // 只读的查找, 只返回已经完全链接且没有被删除的节点
+    node_type *__find_node(const_key_type key) {
+        node_type *pred = m_headNode, *cur = nullptr;
+        for (int i = MAX_LEVEL - 1; i >= 0; i--) {
+            cur = pred->next[i].load(std::memory_order_acquire);
+            while (cur != m_tailNode && cur->key < key) {
+                pred = cur;
+                cur = pred->next[i].load(std::memory_order_acquire);
+            }
+            if (cur != m_tailNode && cur->key == key) break;
+        }
+        if (cur == m_tailNode || !(cur->key == key) ||
+            !cur->fullyLinked.load(std::memory_order_acquire) ||
+            cur->marked.load(std::memory_order_acquire))
+            return nullptr;
+        return cur;
+    }
+
+    static void __unlock(node_type **preds, int highestLocked) {
+        node_type *prevPred = nullptr;
+        for (int i = 0; i <= highestLocked; i++) {
+            if (preds[i] != prevPred) preds[i]->unlock();
+            prevPred = preds[i];
+        }
+    }
+
+    // epoch_reclaimer 的 retire/reclaim 只能由一个线程调用
+    void __retire(node_type *x) {
+        std::lock_guard<std::mutex> lock(m_retireMutex);
+        m_reclaimer.retire(x);
+        if (m_reclaimer.pending() >= RECLAIM_THRESHOLD) m_reclaimer.reclaim();
+    }
+
+    int random_level() { return m_levelGen(); }
+
+   private:
+    skiplist_level_generator m_levelGen;
+    node_type *m_headNode;
+    node_type *m_tailNode;
+    std::atomic<size_t> m_size{0};
+    std::mutex m_retireMutex;
+    epoch_reclaimer m_reclaimer;
+};
@@ -2,10 +2,15 @@
 #pragma once
 
 #include <math.h>
-#include <time.h>
 
 #include <algorithm>
+#include <cstdint>
 #include <iostream>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "SkiplistLevel.h"
 using namespace std;
 
 template <class KeyType, class ValueType>
@@ -28,8 +33,14 @@ struct element_t {
     bool operator==(const element_t& other) { return other.first == first; }
     bool operator!=(const element_t& other) { return other.first != first; }
 };
+/*
+ * 跳表节点, 索引指针数组(tower)与节点在同一次分配中, 紧跟在节点之后:
+ * [element][next[0] ... next[level-1]]
+ * 每个节点只分配一次, 比较 key 和读取 next 通常落在同一个缓存行中.
+ * 节点只能通过 create/destroy 创建和销毁
+ * */
 template <class KeyType, class ValueType>
-struct skipNode {
+struct alignas(alignof(void*)) skipNode {
     using element_type = element_t<KeyType, ValueType>;
     using element_reference_type = element_type&;
     using element_const_reference_type = const element_reference_type;
@@ -41,19 +52,32 @@ struct skipNode {
 
     // element
     element_type element;
+
     // next nodes
-    self_pointer_type* next = nullptr;
+    self_pointer_type* next() {
+        return reinterpret_cast<self_pointer_type*>(this + 1);
+    }
 
-    skipNode() {}
-    explicit skipNode(KeyType key, const ValueType& value, int size) {
-        element.first = key;
-        element.second = value;
-        next = new self_pointer_type[size];
+    static self_pointer_type create(KeyType key, const ValueType& value,
+                                    int level) {
+        void* p = ::operator new(sizeof(self_type) +
+                                 level * sizeof(self_pointer_type));
+        self_pointer_type x = new (p) self_type();
+        x->element.first = key;
+        x->element.second = value;
+        return x;
     }
-    explicit skipNode(element_const_reference_type theElement, int size) {
-        element = theElement;
-        next = new self_pointer_type[size];
+    static self_pointer_type create(element_const_reference_type theElement,
+                                    int level) {
+        return create(theElement.first, theElement.second, level);
     }
+    static void destroy(self_pointer_type x) {
+        x->~self_type();
+        ::operator delete(x);
+    }
+
+   private:
+    skipNode() {}
 };
 
 template <class KeyType, class ValueType>
@@ -86,7 +110,6 @@ class skiplist {
     explicit skiplist(float prob = 0.5f,
                       KeyType tailLargeKey = TAIL_INFINITY_KEY,
                       int max_level = 10, int number_node = -1) {
-        srand(time(nullptr));
         m_prob = prob;
         m_size = 0;
 
@@ -101,23 +124,25 @@ class skiplist {
         // 初始化尾节点
         m_tailKey = tailLargeKey;
         element_type tailPair(m_tailKey, 0);
-        m_tailNode = new node_type(tailPair, 0);
+        m_tailNode = node_type::create(tailPair, 0);
 
         // 初始化头结点
-        m_headNode = new node_type(tailPair, m_maxLevel);
+        m_headNode = node_type::create(tailPair, m_maxLevel);
         for (int i = 0; i < m_maxLevel; i++) {
-            m_headNode->next[i] = m_tailNode;
+            m_headNode->next()[i] = m_tailNode;
         }
         // 缓存前驱节点
         m_forwardNodes = new node_pointer_type[m_maxLevel];
+
+        m_levelGen = skiplist_level_generator(prob, m_maxLevel);
     }
     ~skiplist() {
         while (m_headNode != m_tailNode) {
-            auto x = m_headNode->next[0];
-            delete m_headNode;
+            auto x = m_headNode->next()[0];
+            node_type::destroy(m_headNode);
             m_headNode = x;
         }
-        delete m_tailNode;
+        node_type::destroy(m_tailNode);
         delete[] m_forwardNodes;
     }
 
@@ -130,12 +155,12 @@ class skiplist {
         element_type* operator->() { return &it->element; }
 
         iterator& operator++() {
-            it = it->next[0];
+            it = it->next()[0];
             return *this;
         }
         iterator operator++(int) {
             iterator old(it);
-            it = it->next[0];
+            it = it->next()[0];
             return old;
         }
         bool operator==(const iterator& iter) { return iter.it == it; }
@@ -144,8 +169,8 @@ class skiplist {
        private:
         node_pointer_type it;
     };
-    iterator begin() { return iterator(m_headNode->next[0]); }
-    iterator end() { return iterator(m_tailNode); }
+    iterator begin() const { return iterator(m_headNode->next()[0]); }
+    iterator end() const { return iterator(m_tailNode); }
     using const_iterator = iterator;
 
     node_pointer_type insert(const_key_type key,
@@ -162,12 +187,12 @@ class skiplist {
         }
         // 此时已经保存了合适的前驱节点m_forwardNodes
         // 创建一个具有level层的节点
-        node_pointer_type pNewNode = new node_type(key, value, level);
+        node_pointer_type pNewNode = node_type::create(key, value, level);
 
         // 建立索引节点
         for (int i = level - 1; i >= 0; --i) {
-            pNewNode->next[i] = m_forwardNodes[i]->next[i];
-            m_forwardNodes[i]->next[i] = pNewNode;
+            pNewNode->next()[i] = m_forwardNodes[i]->next()[i];
+            m_forwardNodes[i]->next()[i] = pNewNode;
         }
         m_size++;
         return pNewNode;
@@ -176,6 +201,27 @@ class skiplist {
         return insert(element.first, element.second);
     }
 
+    // key 不存在时插入 (key, value), 只查找一次
+    // 返回 (key 所在的位置, 是否插入)
+    std::pair<iterator, bool> try_emplace(const_key_type key,
+                                          const_reference_value_type value) {
+        node_pointer_type pNode = search(key);
+        if (pNode != m_tailNode && pNode->element.first == key)
+            return {iterator(pNode), false};
+        int level = random_level();
+        // 新增的层的前驱节点都是头结点
+        for (int i = m_curMaxLevel; i < level; i++)
+            m_forwardNodes[i] = m_headNode;
+        if (level > m_curMaxLevel) m_curMaxLevel = level;
+        node_pointer_type pNewNode = node_type::create(key, value, level);
+        for (int i = level - 1; i >= 0; --i) {
+            pNewNode->next()[i] = m_forwardNodes[i]->next()[i];
+            m_forwardNodes[i]->next()[i] = pNewNode;
+        }
+        m_size++;
+        return {iterator(pNewNode), true};
+    }
+
     bool erase(const_key_type key) {
         // 不符合的key
         if (key > m_tailKey) return false;
@@ -184,84 +230,133 @@ class skiplist {
         if (pNode->element.first != key) return false;
         // 更新跳表链表结构
         for (int i = m_curMaxLevel - 1; i >= 0; --i) {
-            // 此处 m_forwardNodes[i]->next[i] 可能不是 pNode
-            if (m_forwardNodes[i]->next[i] == pNode)
-                m_forwardNodes[i]->next[i] = pNode->next[i];
+            // 此处 m_forwardNodes[i]->next()[i] 可能不是 pNode
+            if (m_forwardNodes[i]->next()[i] == pNode)
+                m_forwardNodes[i]->next()[i] = pNode->next()[i];
         }
         // 维护当前最大层级数
         // 当删除一个具有最大层级的节点时，可能会导致
-        // m_headNode->next[m_maxLevel-1]=m_tailNode，那么此时需要降低层级
+        // m_headNode->next()[m_maxLevel-1]=m_tailNode，那么此时需要降低层级
         while (m_curMaxLevel - 1 > 0 &&
-               m_headNode->next[m_curMaxLevel - 1] == m_tailNode) {
+               m_headNode->next()[m_curMaxLevel - 1] == m_tailNode) {
             m_curMaxLevel--;
         }
-        delete pNode;
+        node_type::destroy(pNode);
         m_size--;
         return true;
     }
 
-    node_pointer_type find_node(const_key_type key) {
-        node_pointer_type x = search(key);
-        if (x)
-            return x->element.first == key ? x : nullptr;
-        else
-            return nullptr;
+    // 只读的查找, 不修改任何成员, 多个线程可以同时查找
+    node_pointer_type find_node(const_key_type key) const {
+        node_pointer_type x = lower_bound_node(key);
+        return x != m_tailNode && x->element.first == key ? x : nullptr;
     }
     // 返回一个迭代器
-    iterator find(const_key_type key) {
+    iterator find(const_key_type key) const {
         auto x = find_node(key);
         if (x == nullptr) return end();
         return iterator(x);
     }
 
-    element_pointer_type find_element(const_key_type key) {
+    element_pointer_type find_element(const_key_type key) const {
         node_pointer_type x = find_node(key);
         if (!x) return nullptr;
         return &x->element;
     }
 
-    /*  搜索并把遇到的最后一个节点保存下来 */
+    // 第一个不小于 key 的节点, 不保存前驱节点
+    node_pointer_type lower_bound_node(const_key_type key) const {
+        node_pointer_type forwardNode = m_headNode;
+        for (int i = m_curMaxLevel - 1; i >= 0; --i) {
+            node_pointer_type x = forwardNode->next()[i];
+            while (x != m_tailNode && x->element.first < key) {
+                forwardNode = x;
+                x = forwardNode->next()[i];
+                // 下降一层时要比较的节点, 与本层的比较同时加载
+                if (i > 0) prefetch(forwardNode->next()[i - 1]);
+            }
+        }
+        return forwardNode->next()[0];
+    }
+
+    /*  搜索并把遇到的最后一个节点保存下来, 供插入/删除使用 */
     node_pointer_type search(const_key_type key) {
         node_pointer_type forwardNode = m_headNode;
         // 外层循环: 不断的指向下一层
         for (int i = m_curMaxLevel - 1; i >= 0; --i) {
             // 内层循环: 指向当前层链表的下一个节点
-            while (forwardNode->next[i] != m_tailNode &&
-                   forwardNode->next[i]->element.first < key) {
-                forwardNode = forwardNode->next[i];
+            node_pointer_type x = forwardNode->next()[i];
+            while (x != m_tailNode && x->element.first < key) {
+                forwardNode = x;
+                x = forwardNode->next()[i];
+                if (i > 0) prefetch(forwardNode->next()[i - 1]);
             }
             // 保存前驱节点指针
             m_forwardNodes[i] = forwardNode;
         }
         // 最终回到第0层
-        return forwardNode->next[0];
+        return forwardNode->next()[0];
+    }
+
+    int size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    // 层数分布: [l] 为恰好有 l 层索引的节点个数, [0] 总是 0
+    std::vector<size_t> level_histogram() const {
+        std::vector<size_t> h(m_curMaxLevel + 1, 0);
+        // 第 i 层链表中的节点都至少有 i+1 层
+        for (int i = 0; i < m_curMaxLevel; i++)
+            for (node_pointer_type x = m_headNode->next()[i]; x != m_tailNode;
+                 x = x->next()[i])
+                h[i + 1]++;
+        for (int l = 1; l < m_curMaxLevel; l++) h[l] -= h[l + 1];
+        return h;
+    }
+    // 所有节点(包括头尾节点)和前驱缓存占用的堆内存字节数
+    size_t memory_bytes() const {
+        size_t links = 0;
+        auto h = level_histogram();
+        for (size_t l = 1; l < h.size(); l++) links += h[l] * l;
+        return (m_size + 2) * sizeof(node_type) +
+               (links + 2 * m_maxLevel) * sizeof(node_pointer_type);
     }
 
-    int size() { return m_size; }
+    // 删除所有节点
+    void clear() {
+        node_pointer_type x = m_headNode->next()[0];
+        while (x != m_tailNode) {
+            node_pointer_type y = x->next()[0];
+            node_type::destroy(x);
+            x = y;
+        }
+        for (int i = 0; i < m_maxLevel; i++) m_headNode->next()[i] = m_tailNode;
+        m_curMaxLevel = 0;
+        m_size = 0;
+    }
 
     void output() {
         if (m_size <= 0) return;
         for (int i = m_curMaxLevel - 1; i >= 0; i--) {
-            node_pointer_type cur = m_headNode->next[i];
+            node_pointer_type cur = m_headNode->next()[i];
             cout << "head" << i << " => ";
             while (cur != m_tailNode) {
-                if (cur == m_headNode->next[i]) {
+                if (cur == m_headNode->next()[i]) {
                     cout << cur->element.first << ":" << cur->element.second;
                 } else {
                     cout << "->" << cur->element.first << ":"
                          << cur->element.second;
                 }
-                cur = cur->next[i];
+                cur = cur->next()[i];
             }
             cout << endl;
         }
     }
 
     void output_bottom() {
-        node_pointer_type x = m_headNode->next[0];
+        node_pointer_type x = m_headNode->next()[0];
         while (x != m_tailNode) {
             cout << "->" << x->element.first << ":" << x->element.second;
-            x = x->next[0];
+            x = x->next()[0];
         }
         cout << endl;
     }
@@ -281,12 +376,14 @@ class skiplist {
     // 	int level = rand() % m_maxLevel + 1;
     // 	return level;
     // }
-    int random_level() {
-        int level = 1;
-        while (((double)(rand()) / RAND_MAX) < (m_prob) && level < m_maxLevel) {
-            level++;
-        }
-        return level;
+    // 每个线程使用自己的随机数发生器, 见 SkiplistLevel.h
+    int random_level() { return m_levelGen(); }
+    static void prefetch(const void* p) {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(p);
+#else
+        (void)p;
+#endif
     }
     int MaxLevel(int numberOfnode, float prob) {
         return (int)(ceil(logf((float)numberOfnode) / logf((float)1 / prob)));
@@ -295,6 +392,7 @@ class skiplist {
    private:
     // 随机概率
     float m_prob;
+    skiplist_level_generator m_levelGen;
     key_type m_tailKey;
     // 最大索引层数
     int m_maxLevel;
@@ -2,8 +2,16 @@
 #include <iostream>
 #include <iterator>
 #include <regex>
+#include <thread>
 
+#include "ConcurrentTrieTree.h"
+#include "DAWG.h"
+#include "DoubleArrayTrie.h"
+#include "FileScan.h"
+#include "RadixTree.h"
+#include "TrieImage.h"
 #include "TrieTree.h"
+#include "concurrent_skiplist.h"
 #include "skiplist.h"
 #include "ClockTime.h"
 using namespace std;
@@ -93,6 +101,463 @@ void test4() {
     for (auto x : t) cout << x << endl;
 }
 
+void test5() {
+    // 双数组Trie
+    ifstream ifs("text.txt");
+    string s((istreambuf_iterator<char>(ifs)), istreambuf_iterator<char>());
+    auto words = regex_matche_word(s);
+
+    TrieTree<char, MODE> trie;
+    for (auto &word : words) trie.insert(word);
+    trie.insert("the");
+    DoubleArrayTrie<char> dat(trie);
+
+    int mismatch = 0;
+    for (auto &word : words)
+        if (dat.count(word) != trie.count(word)) mismatch++;
+    cout << "mismatch: " << mismatch << "\tthe: " << dat.count("the")
+         << "\tth: " << dat.count("th") << "\tLinuxes: " << dat.count("Linuxes")
+         << endl;
+    for (auto &x : dat.prefixWords("di")) cout << x << " ";
+    cout << endl;
+    cout << "states: " << dat.size() << "\tbytes: " << dat.size_in_bytes()
+         << endl;
+}
+
+void test6() {
+    // 编译为稠密DFA后的ac自动机
+    AC_automaton<char, MODE> aca;
+    vector<string> ss{"bcd", "ce", "ce", "ababa", "abce"};
+
+    aca.buildTrieTree(ss);
+    aca.buildAC_automaton();
+    aca.compile();
+    aca.start_ac_automaton("abcexbcdxxxcebcdbceabcece");
+}
+
+void test7() {
+    // 匹配回调接口
+    AC_automaton<char, MODE> aca;
+    vector<string> ss{"abcd", "bc", "b", "abcde", "e"};
+    aca.buildTrieTree(ss);
+    aca.buildAC_automaton();
+    string text = "xabcdex";
+
+    auto print = [&](const ac_match_t &m) {
+        cout << "(" << m.id << "," << m.start << "," << m.length << ") ";
+    };
+    aca.match(text, print);
+    cout << endl;
+    aca.match(text, print, ac_match_kind::leftmost_first);
+    cout << endl;
+    aca.match(text, print, ac_match_kind::leftmost_longest);
+    cout << endl;
+    aca.compile();
+    aca.match(text, print, ac_match_kind::leftmost_longest);
+    cout << endl;
+    cout << aca.is_match(text) << " " << aca.is_match("xyz") << " "
+         << aca.find_first(text)->id << endl;
+    // 输出列表
+    for (auto x : aca.outputs(aca.pattern(3))) cout << x->id << " ";
+    cout << endl;
+}
+
+void test8() {
+    // 流式扫描, 匹配可以跨越缓冲区边界
+    AC_automaton<char, MODE> aca;
+    vector<string> ss{"bcd", "ce", "ce", "ababa", "abce"};
+    aca.buildTrieTree(ss);
+    aca.buildAC_automaton();
+
+    string text = "abcexbcdxxxcebcdbceabcece";
+    auto sc = aca.make_scanner();
+    for (size_t i = 0; i < text.size(); i += 3) {
+        sc.feed(string_view(text).substr(i, 3), [](const ac_match_t &m) {
+            cout << "(" << m.id << "," << m.start << "," << m.length << ") ";
+        });
+    }
+    cout << endl << sc.offset() << endl;
+}
+
+void test9() {
+    // 扫描文件
+    AC_automaton<char, MODE> aca;
+    aca.buildTrieTree({"Linux", "the", "package"});
+    aca.buildAC_automaton();
+    for (auto io : {scan_io::mmap, scan_io::read}) {
+        int n = 0;
+        auto bytes =
+            scan_file(aca, "text.txt", [&](const ac_match_t &) { n++; }, io);
+        cout << bytes << " " << n << endl;
+    }
+    // 读取出错(目录无法 read)时返回 -1
+    cout << scan_file(aca, ".", [](const ac_match_t &) {}, scan_io::read)
+         << endl;
+}
+
+void test10() {
+    // 多线程并行扫描
+    AC_automaton<char, MODE> aca;
+    aca.buildTrieTree({"Linux", "the", "package", "e"});
+    aca.buildAC_automaton();
+    ifstream ifs("text.txt");
+    string text((istreambuf_iterator<char>(ifs)), istreambuf_iterator<char>());
+    string s;
+    while (s.size() < (1 << 20)) s += text;
+    auto a = aca.find_all(s);
+    auto b = aca.parallel_find_all(s, 4);
+    bool same = a.size() == b.size();
+    for (size_t i = 0; same && i < a.size(); i++)
+        same = a[i].id == b[i].id && a[i].start == b[i].start;
+    cout << a.size() << " " << b.size() << " " << same << " ";
+
+    // visit 提前终止时两种扫描返回相同的位置
+    int n = 0, m = 0;
+    auto stop = [](int &k) {
+        return [&k](const ac_match_t &) { return ++k < 20; };
+    };
+    cout << (scan_file(aca, "text.txt", stop(n), scan_io::read) ==
+             parallel_scan_file(aca, "text.txt", stop(m), 4))
+         << endl;
+}
+
+void test11() {
+    // 使用内存池分配节点
+    TrieTree<char, MODE, '\0', arena_node_allocator> trie;
+    auto words = regex_matche_word(
+        "the quick brown fox jumps over the lazy dog then the fox sleeps");
+    for (auto &word : words) trie.insert(word);
+    trie.erase("fox");
+    trie.erase("then");
+    cout << trie.count("the") << " " << trie.count("fox") << " "
+         << trie.count("then") << " " << trie.prefixWords("th").size() << endl;
+    trie.clear();
+    trie.insert("fox");
+    cout << trie.count("the") << " " << trie.count("fox") << endl;
+}
+
+void test12() {
+    // 由有序的单词批量构建
+    ifstream ifs("text.txt");
+    string s((istreambuf_iterator<char>(ifs)), istreambuf_iterator<char>());
+    auto words = regex_matche_word(s);
+    sort(words.begin(), words.end());
+
+    TrieTree<char, MODE> a, b;
+    for (auto &word : words) a.insert(word);
+    cout << b.insert_sorted(words.begin(), words.end()) << " ";
+    int mismatch = 0;
+    for (auto &word : words)
+        if (a.count(word) != b.count(word)) mismatch++;
+    cout << mismatch << " " << (a.prefixWords("d") == b.prefixWords("d"))
+         << " ";
+
+    // 非 ASCII 字节按无符号排序, 与 std::sort 的顺序一致
+    vector<string> utf8_words{"café", "apple", "éclair", "caffè", "cafe"};
+    sort(utf8_words.begin(), utf8_words.end());
+    TrieTree<char, MODE> c;
+    cout << c.insert_sorted(utf8_words.begin(), utf8_words.end()) << " "
+         << c.prefixWords("caf").size() << " " << c.count("éclair") << endl;
+}
+
+void test13() {
+    // 最小化的单词图, 共享后缀
+    TrieTree<char, MODE> trie;
+    for (auto stem : {"walk", "talk", "jump", "play", "work"})
+        for (auto suffix : {"", "s", "ed", "ing", "er", "ers"})
+            trie.insert(string(stem) + suffix);
+    trie.insert("walking");
+    DAWG<char> dawg(trie);
+    cout << dawg.count("walking") << " " << dawg.count("talked") << " "
+         << dawg.count("talk") << " " << dawg.count("walkin") << endl;
+    for (auto &x : dawg.prefixWords("play")) cout << x << " ";
+    cout << endl;
+    cout << "trie nodes: " << dawg.source_node_count()
+         << "\tdawg nodes: " << dawg.node_count() << endl;
+
+    // 非 ASCII 字节按无符号排序, 与 std::sort 的顺序一致
+    vector<string> utf8_words{"apple", "café", "caffè", "zebra", "éclair"};
+    TrieTree<char, 1> utrie;
+    for (auto &w : utf8_words) utrie.insert(w);
+    DAWG<char> ud(utrie);
+    sort(utf8_words.begin(), utf8_words.end());
+    DAWG<char> sd;
+    bool sorted = sd.build_sorted(utf8_words.begin(), utf8_words.end());
+    cout << ud.size() << " " << sorted << " " << sd.size();
+    for (auto &w : utf8_words) cout << " " << ud.count(w) << sd.count(w);
+    cout << endl;
+}
+
+void test14() {
+    // 保存快照后 mmap 加载, 原地查询
+    TrieTree<char, MODE> trie;
+    for (auto w : {"apple", "apply", "app", "banana", "band", "app"})
+        trie.insert(w);
+    AC_automaton<char> aca;
+    aca.buildTrieTree({"he", "she", "his", "hers"});
+    aca.buildAC_automaton();
+    if (!save_trie_image(trie, "trie.img") || !save_trie_image(aca, "ac.img"))
+        return;
+    trie_image<char> img, acimg;
+    if (!img.open("trie.img") || !acimg.open("ac.img")) return;
+    cout << img.count("app") << " " << img.count("apply") << " "
+         << img.count("ban") << " " << img.search("band") << endl;
+    for (auto &x : img.prefixWords("ap")) cout << x << " ";
+    cout << endl;
+    string s = "ushers";
+    acimg.match(s, [&](const ac_match_t &m) {
+        cout << s.substr(m.start, m.length) << "\tindex: " << m.start
+             << "\tid: " << m.id << '\n';
+    });
+    img.close();
+    acimg.close();
+
+    // 截断或下标越界的快照在 attach 时被拒绝
+    ifstream ifs("ac.img", ios::binary);
+    string bytes((istreambuf_iterator<char>(ifs)), istreambuf_iterator<char>());
+    vector<uint64_t> buf((bytes.size() + 7) / 8);
+    memcpy(buf.data(), bytes.data(), bytes.size());
+    auto h = (const trie_image_header *)buf.data();
+    trie_image<char> bad;
+    bool ok = bad.attach(buf.data(), bytes.size());
+    ((uint32_t *)((char *)buf.data() + h->targets_offset))[0] = 1000;
+    cout << ok << " " << bad.attach(buf.data(), bytes.size()) << " "
+         << bad.attach(buf.data(), bytes.size() - 8) << " ";
+    // output 指向不比自己浅的节点(she -> his)时, 匹配的起点会越过文本开头
+    ((uint32_t *)((char *)buf.data() + h->targets_offset))[0] = 1;
+    auto nodes = (trie_image_node *)((char *)buf.data() + h->nodes_offset);
+    cout << bad.attach(buf.data(), bytes.size()) << " "
+         << bad.pattern_occurrences(1) << " " << bad.pattern_occurrences(99)
+         << " ";
+    nodes[h->node_count - 2].output = (uint32_t)h->node_count - 3;
+    cout << bad.attach(buf.data(), bytes.size()) << endl;
+    remove("trie.img");
+    remove("ac.img");
+}
+
+void test15() {
+    // 惰性迭代器, 两个迭代器互不影响; clone 按节点复制
+    TrieTree<char, 0> trie;
+    for (auto w : {"to", "tea", "ted", "ten", "i", "in", "inn", "tea"})
+        trie.insert(w);
+    auto a = trie.begin(), b = trie.begin();
+    ++b;
+    for (; b != trie.end(); ++a, ++b) cout << *a << "<" << *b << " ";
+    cout << endl;
+    auto copy = trie.clone();
+    trie.clear();
+    for (auto &w : *copy) cout << w << " ";
+    cout << endl;
+}
+
+void test16() {
+    // top-K 补全, 按出现次数从大到小
+    TrieTree<char, MODE> trie;
+    vector<pair<string, int>> freq{{"car", 5}, {"cart", 2}, {"carbon", 9},
+                                   {"care", 7}, {"cat", 3}, {"dog", 8}};
+    for (auto &[w, n] : freq)
+        for (int i = 0; i < n; i++) trie.insert(w);
+    for (auto &[w, n] : trie.topK("ca", 3)) cout << w << ":" << n << " ";
+    cout << endl;
+    trie.erase("carbon");
+    for (auto &[w, n] : trie.topK("car", 2)) cout << w << ":" << n << " ";
+    cout << endl;
+}
+
+void test17() {
+    // 并发读写: 读线程不断查询固定的单词, 写线程反复插入/删除其他单词
+    ConcurrentTrieTree<char> trie;
+    vector<string> fixed, churn;
+    for (int i = 0; i < 1000; i++) {
+        fixed.push_back("w" + to_string(i));
+        churn.push_back("w" + to_string(i) + "-" + to_string(i % 7));
+    }
+    for (auto &w : fixed) trie.insert(w);
+    atomic<bool> stop{false};
+    atomic<int> errors{0};
+    vector<thread> readers;
+    for (int t = 0; t < 4; t++)
+        readers.emplace_back([&, t] {
+            for (size_t i = t; !stop; i++) {
+                if (trie.count(fixed[i % fixed.size()]) != 1) errors++;
+                trie.search(churn[i * 7 % churn.size()]);
+                if (i % 256 == 0 && trie.prefixWords("w99").empty()) errors++;
+            }
+        });
+    for (int i = 0; i < 100000; i++) {
+        auto &w = churn[i * 31 % churn.size()];
+        if (i % 3) trie.insert(w);
+        else trie.erase(w);
+    }
+    stop = true;
+    for (auto &t : readers) t.join();
+    cout << "errors: " << errors << "\tw1: " << trie.count("w1")
+         << "\tw1-1: " << trie.count("w1-1") << endl;
+}
+
+void test18() {
+    // 并发跳表: 多个线程同时插入/删除不同的 key, 读线程不加锁查找
+    concurrent_skiplist<int, int> sl;
+    for (int k = 0; k < 1000; k += 2) sl.insert(k, k * k);
+    atomic<bool> stop{false};
+    atomic<int> errors{0};
+    thread reader([&] {
+        for (int i = 0; !stop; i++) {
+            int k = i % 500 * 2;
+            auto v = sl.find(k);
+            if (!v || *v != k * k) errors++;
+        }
+    });
+    vector<thread> writers;
+    for (int t = 0; t < 3; t++)
+        writers.emplace_back([&, t] {
+            for (int i = 0; i < 30000; i++) {
+                int k = (i * 7 + t) % 500 * 2 + 1;
+                if (i % 2)
+                    sl.erase(k);
+                else
+                    sl.insert(k, k * k);
+            }
+        });
+    for (auto &w : writers) w.join();
+    stop = true;
+    reader.join();
+    int odd = 0;
+    sl.for_each([&](int k, int) { odd += k % 2; });
+    cout << "errors: " << errors << "\tsize: " << sl.size() - odd
+         << "\tcontains 998: " << sl.contains(998) << endl;
+
+    // 活跃的读者多于固定槽位时 pin() 使用溢出槽位, 不会等待
+    epoch_reclaimer r;
+    vector<epoch_reclaimer::guard> guards;
+    for (size_t i = 0; i < epoch_reclaimer::MAX_THREADS + 36; i++)
+        guards.push_back(r.pin());
+    r.retire(new int(1));
+    size_t freed = r.reclaim();
+    guards.clear();
+    cout << "pinned: " << freed << " " << r.pending()
+         << "\treleased: " << r.reclaim() << endl;
+}
+
+void test19() {
+    // 跳表: 非 2 的负整数次幂的概率走逐层生成层数的路径
+    skiplist<int, int> a(0.5f), b(0.3f);
+    for (int i = 0; i < 1000; i++) a[i * 7 % 1000] = i, b[i * 7 % 1000] = i;
+    for (int i = 0; i < 1000; i += 2) a.erase(i), b.erase(i);
+    int n = 0;
+    for (auto &x : a) n += x.first == b.find(x.first)->first;
+    cout << a.size() << " " << b.size() << " " << n << " "
+         << (a.find(500) == a.end()) << endl;
+}
+
+void test20() {
+    // 自适应孩子容器, 孩子个数增加时从 node4 依次换成 node256
+    TrieTree<char, 3> trie;
+    for (int c = 0; c < 256; c++) trie.insert(string(1, (char)(c + 1)) + "x");
+    trie.insert("ab");
+    trie.insert("ab");
+    cout << trie.count("ab") << " " << trie.count("\xffx") << " "
+         << trie.count("\x01") << " " << trie.get().size() << endl;
+    AC_automaton<char, 3> aca;
+    aca.buildTrieTree({"he", "she", "his", "hers"});
+    aca.buildAC_automaton();
+    cout << aca.find_all("ushers").size() << endl;
+}
+
+void test21() {
+    // 路径压缩: 只有一个孩子的连续节点合并为一条边
+    RadixTree<char> tree;
+    for (auto w : {"/usr/lib/libc.so", "/usr/lib/libm.so", "/usr/bin/env",
+                   "/usr/lib/libc.so"})
+        tree.insert(w);
+    cout << tree.count("/usr/lib/libc.so") << " " << tree.count("/usr/lib")
+         << "\tnodes: " << tree.node_count() << endl;
+    for (auto &w : tree.prefixWords("/usr/l")) cout << w << " ";
+    cout << endl;
+    tree.erase("/usr/bin/env");
+    cout << "nodes: " << tree.node_count() << endl;
+}
+
+void test22() {
+    // 批量查找: 结果与逐个 search/count 相同
+    TrieTree<char, 3> trie;
+    for (auto w : {"she", "he", "his", "hers", "he"}) trie.insert(w);
+    vector<string> keys{"he", "her", "hers", "", "x", "his"};
+    auto nodes = trie.search_batch(keys);
+    auto counts = trie.count_batch(keys);
+    for (size_t i = 0; i < keys.size(); i++)
+        cout << "[" << keys[i] << "] " << (nodes[i] == trie.search(keys[i]))
+             << " " << counts[i] << "\t";
+    cout << endl;
+}
+
+void test23() {
+    // 结构统计; 定义 TRIETREE_STATS 时热路径计数器才会计数
+    TrieTree<char, 1> trie;
+    for (auto w : {"he", "she", "his", "hers", "he"}) trie.insert(w);
+    auto st = trie.stats();
+    cout << "nodes: " << st.nodes << " words: " << st.words << "/"
+         << st.occurrences << " max_depth: " << st.max_depth
+         << " fanout[1]: " << st.fanout_histogram[1] << endl;
+
+    AC_automaton<char> aca;
+    aca.buildTrieTree({"he", "she", "his", "hers"});
+    aca.buildAC_automaton();
+    aca.match("ushers", [](const ac_match_t &) {});
+    auto ast = aca.stats();
+    cout << "fail depth: " << ast.avg_fail_depth << "/" << ast.max_fail_depth
+         << " outputs: " << ast.max_outputs << endl;
+#ifdef TRIETREE_STATS
+    auto &c = aca.counters();
+    cout << "transitions: " << c.transitions << " fail hops: " << c.fail_hops
+         << " matches: " << c.matches << endl;
+#endif
+}
+
+void test24() {
+    // 不区分大小写的 UTF-8 匹配, 输出原文中的位置
+    AC_automaton<char> aca(ac_case::unicode);
+    aca.buildTrieTree({"straße", "σίσυφος", "привет", "he"});
+    aca.buildAC_automaton();
+    aca.start_ac_automaton("STRAßE Σίσυφος ПРИВЕТ Hello");
+    // 快照不保存大小写的转移, 拒绝保存
+    cout << save_trie_image(aca, "ci.img") << endl;
+
+    AC_automaton<char> acb(ac_case::ascii);
+    acb.buildTrieTree({"hello", "привет"});
+    acb.buildAC_automaton();
+    cout << acb.find_all("HeLLo ПРИВЕТ привет").size() << endl;
+}
+
+void test25() {
+    // 编辑距离不超过 k 的单词
+    TrieTree<char, 2> trie;
+    for (auto w : {"hello", "help", "hell", "shell", "yellow", "hello"})
+        trie.insert(w);
+    for (auto &[w, c] : trie.fuzzy("helo", 1)) cout << w << ":" << c << " ";
+    cout << endl;
+    trie.fuzzy("yelow", 2, [](const string &w, int, size_t d) {
+        cout << w << ":" << d << " ";
+    });
+    cout << endl;
+    // 很大的 k 与不限制距离相同, 返回所有单词
+    cout << trie.fuzzy("helo", SIZE_MAX - 1).size() << " "
+         << trie.fuzzy("helo", SIZE_MAX).size() << endl;
+}
+
+void test26() {
+    // 通配符模式
+    TrieTree<char, 0> trie;
+    for (auto w : {"error", "errors", "eraser", "catalog", "backlog", "blog",
+                   "dialog", "fog"})
+        trie.insert(w);
+    for (auto p : {"err?r*", "[a-f]*log", "?log", "*o?"}) {
+        cout << p << ":";
+        for (auto &[w, c] : trie.glob(p)) cout << " " << w;
+        cout << endl;
+    }
+}
+
 int main() {
     test1();
     cout << endl;
@@ -101,5 +566,30 @@ int main() {
 
     test3();
     test4();
+    test5();
+    cout << endl;
+    test6();
+    cout << endl;
+    test7();
+    cout << endl;
+    test8();
+    test9();
+    test10();
+    test11();
+    test12();
+    test13();
+    test14();
+    test15();
+    test16();
+    test17();
+    test18();
+    test19();
+    test20();
+    test21();
+    test22();
+    test23();
+    test24();
+    test25();
+    test26();
     return 0;
 }